@@ -25,20 +25,36 @@
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include <regex>
+#include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <boost/foreach.hpp>
 #include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <unistd.h>
 #include <llvm/Support/CommandLine.h>
 #include "clang/Tooling/Tooling.h"
+#include "clang/Tooling/ArgumentsAdjusters.h"
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string.hpp>
 #include "clang/Frontend/FrontendAction.h"
 #include "../Graph/LowMemoryTAGraph.h"
+#include "PCHBuilder.h"
+#include "WorkerPool.h"
+#include "../File/ASTCache.h"
+#include "../File/CachedFileSystem.h"
+#include "../File/SnapshotFileSystem.h"
+#include "../File/FilePrefetcher.h"
 #include "../TupleAttribute/TAProcessor.h"
 #include "../Walker/ASTWalker.h"
 #include "../Walker/BlobWalker.h"
 #include "../Walker/PartialWalker.h"
+#include "../Walker/VisitorWalker.h"
+#include "../Walker/ExtractAction.h"
 
 using namespace std;
 using namespace clang::tooling;
@@ -148,27 +164,7 @@ int ClangDriver::getNumFiles(){
  * @return Whether a feature was enabled.
  */
 bool ClangDriver::enableFeature(string feature){
-    if (feature.compare("cSubSystem") == 0){
-        toggle.cSubSystem = false;
-    } else if (feature.compare("cVariable") == 0){
-        toggle.cVariable = false;
-    } else if (feature.compare("cUnion") == 0){
-        toggle.cUnion = false;
-    } else if (feature.compare("cStruct") == 0){
-        toggle.cStruct = false;
-    } else if (feature.compare("cFunction") == 0){
-        toggle.cFunction = false;
-    } else if (feature.compare("cFile") == 0){
-        toggle.cFile = false;
-    } else if (feature.compare("cEnum") == 0){
-        toggle.cEnum = false;
-    } else if (feature.compare("cClass") == 0){
-        toggle.cClass = false;
-    } else {
-        return false;
-    }
-
-    return true;
+    return setFeature(&toggle, feature, false);
 }
 
 /**
@@ -177,26 +173,40 @@ bool ClangDriver::enableFeature(string feature){
  * @return Whether a feature was disabled.
  */
 bool ClangDriver::disableFeature(string feature){
-    if (feature.compare("cSubSystem") == 0){
-        toggle.cSubSystem = true;
-    } else if (feature.compare("cVariable") == 0){
-        toggle.cVariable = true;
-    } else if (feature.compare("cUnion") == 0){
-        toggle.cUnion = true;
-    } else if (feature.compare("cStruct") == 0){
-        toggle.cStruct = true;
-    } else if (feature.compare("cFunction") == 0){
-        toggle.cFunction = true;
-    } else if (feature.compare("cFile") == 0){
-        toggle.cFile = true;
-    } else if (feature.compare("cEnum") == 0){
-        toggle.cEnum = true;
-    } else if (feature.compare("cClass") == 0){
-        toggle.cClass = true;
+    return setFeature(&toggle, feature, true);
+}
+
+/**
+ * Adds an output profile to the generation settings. Profiles are written as
+ * MODE[:FEATURE,...] where MODE is blob or partial and the features are disabled
+ * on top of the current toggles.
+ * @param spec The profile specification.
+ * @param settings The settings to add the profile to.
+ * @return Whether the profile was valid.
+ */
+bool ClangDriver::addProfile(string spec, GenerateSettings* settings){
+    Profile profile;
+    profile.exclude = toggle;
+
+    //Gets the walker type.
+    size_t split = spec.find(':');
+    string mode = spec.substr(0, split);
+    if (mode.compare("blob") == 0){
+        profile.blobMode = true;
+    } else if (mode.compare("partial") == 0){
+        profile.blobMode = false;
     } else {
         return false;
     }
 
+    //Gets the disabled features.
+    if (split != string::npos){
+        for (string feature : splitList(spec.substr(split + 1))){
+            if (!setFeature(&profile.exclude, feature, true)) return false;
+        }
+    }
+
+    settings->profiles.push_back(profile);
     return true;
 }
 
@@ -208,7 +218,8 @@ bool ClangDriver::disableFeature(string feature){
  * @param verboseMode Whether the user wants verbose output.
  * @return The success of ClangEx.
  */
-bool ClangDriver::processAllFiles(bool blobMode, string mergeFile, bool lowMemory, int startNum){
+bool ClangDriver::processAllFiles(bool blobMode, string mergeFile, bool lowMemory, GenerateSettings settings,
+                                  int startNum){
     bool success = true;
 
     int argc = 0;
@@ -250,6 +261,8 @@ bool ClangDriver::processAllFiles(bool blobMode, string mergeFile, bool lowMemor
             delete ClangExCategory;
             return false;
         }
+    } else if (lowMemory && recoveryMode){
+        mergeGraph = new LowMemoryTAGraph(lowMemoryPath.string(), recoveryNum);
     } else if (lowMemory){
         if (lowMemoryPath.empty()) mergeGraph = new LowMemoryTAGraph();
         else mergeGraph = new LowMemoryTAGraph(lowMemoryPath.string());
@@ -260,26 +273,120 @@ bool ClangDriver::processAllFiles(bool blobMode, string mergeFile, bool lowMemor
     //Get the exclusions.
     TAGraph::ClangExclude exclude = toggle;
 
+    //Each profile gets its own graph. The first profile uses the merge graph.
+    vector<Profile> profiles = settings.profiles;
+    if (profiles.size() == 0) profiles.push_back(Profile{blobMode, exclude});
+    vector<TAGraph*> profileGraphs;
+    profileGraphs.push_back(mergeGraph);
+    for (int p = 1; p < profiles.size(); p++){
+        if (!lowMemory) profileGraphs.push_back(new TAGraph());
+        else if (lowMemoryPath.empty()) profileGraphs.push_back(new LowMemoryTAGraph());
+        else profileGraphs.push_back(new LowMemoryTAGraph(lowMemoryPath.string()));
+    }
+
     //Dump settings.
-    if (lowMemory) dynamic_cast<LowMemoryTAGraph*>(mergeGraph)->dumpSettings(files, exclude, blobMode);
+    if (lowMemory){
+        for (int p = 0; p < profiles.size(); p++){
+            dynamic_cast<LowMemoryTAGraph*>(profileGraphs.at(p))->dumpSettings(files, profiles.at(p).exclude,
+                                                                              profiles.at(p).blobMode,
+                                                                              generateSettingLines(settings));
+        }
+    }
+
+    //Resumes from the journal if one was left behind.
+    unordered_set<int> completed;
+    if (lowMemory && recoveryMode && dynamic_cast<LowMemoryTAGraph*>(mergeGraph)->recoverJournal(&completed)){
+        startNum = 0;
+        clangPrint->printResumeRun((int) completed.size());
+    }
+
+    //Headers are only extracted once per run when the cache is requested.
+    if (settings.headerCache) headerCache = new HeaderCache();
+
+    //Serves the source tree from a snapshot.
+    fileSystem = clang::vfs::getRealFileSystem();
+    bool snapshotLoaded = false;
+    if (!settings.snapshotFile.empty()){
+        snapshotLoaded = loadSnapshot(settings.snapshotFile, OptionsParser, clangPrint);
+        if (!snapshotLoaded) cerr << "Warning: The snapshot " << settings.snapshotFile << " could not be used." << endl;
+    }
+
+    //Reads ahead of the parser. Not needed when files are served from the snapshot.
+    if (settings.prefetchDepth > 0 && !snapshotLoaded) prefetcher = new FilePrefetcher(files, settings.prefetchDepth);
+
+    //Each file gets its own tool in low-memory mode so stats and reads are shared between them.
+    if (lowMemory) {
+        fileCache = new CachedFileSystem(fileSystem, FILE_CACHE_SIZE);
+        fileSystem = fileCache;
+    }
+
+    //Loads ASTs from earlier runs.
+    if (!settings.astCacheDir.empty()){
+        astCache = new ASTCache(settings.astCacheDir);
+        if (!astCache->isValid()){
+            cerr << "Warning: The AST cache directory " << settings.astCacheDir << " could not be used." << endl;
+            delete astCache;
+            astCache = nullptr;
+        }
+    }
+
+    //Builds the shared system includes once.
+    if (settings.precompiledPreamble){
+        preamble = new PCHBuilder((lowMemoryPath.empty()) ? current_path() : lowMemoryPath);
+        if (preamble->build(files, OptionsParser->getCompilations())){
+            clangPrint->printPreamble(preamble->getNumIncludes(), preamble->getNumFiles());
+        } else {
+            cerr << "Warning: No precompiled preamble could be built. Files will be parsed normally." << endl;
+            delete preamble;
+            preamble = nullptr;
+        }
+    }
 
     //Creates the command line arguments.
     int fileSplit = (lowMemory) ? FILE_SPLIT : getNumFiles();
     clangPrint->printProcessStatus(Printer::COMPILING);
-    for (int i = startNum; i < getNumFiles(); i += fileSplit) {
-        runAnalysis(blobMode, lowMemory, mergeGraph, i, clangPrint, exclude, OptionsParser);
-        if (lowMemory) dynamic_cast<LowMemoryTAGraph*>(mergeGraph)->purgeCurrentGraph();
+    if (settings.isolate || (lowMemory && settings.numJobs > 1)){
+        //Parallel jobs run in forked workers since Clang changes the working directory of the whole process.
+        success = runIsolatedAnalysis(profiles, lowMemory, profileGraphs, startNum, completed, clangPrint,
+                                      OptionsParser, settings);
+    } else {
+        for (int i = startNum; i < getNumFiles(); i += fileSplit) {
+            if (completed.find(i) != completed.end()) continue;
+
+            runAnalysis(profiles, lowMemory, profileGraphs, i, clangPrint, OptionsParser, settings);
+            if (!lowMemory) continue;
+            for (auto graph : profileGraphs) dynamic_cast<LowMemoryTAGraph*>(graph)->commitFile(i, files.at(i).string());
+        }
+        if (lowMemory) {
+            for (auto graph : profileGraphs) dynamic_cast<LowMemoryTAGraph*>(graph)->flushJournal();
+        }
     }
 
     //Shifts the graphs.
     if (success) {
-        mergeGraph->resolveExternalReferences(clangPrint, false);
-        mergeGraph->resolveFiles(exclude);
-        graphs.push_back(mergeGraph);
+        for (int p = 0; p < profiles.size(); p++){
+            TAGraph* graph = profileGraphs.at(p);
+            graph->resolveExternalReferences(clangPrint, false);
+            clangPrint->printTraversal(TRAVERSAL_NAMES[settings.traversal], graph->getNumNodes(), graph->getNumEdges());
+            graph->resolveFiles(profiles.at(p).exclude, max((int) thread::hardware_concurrency(), 1));
+            graphs.push_back(graph);
+        }
     }
 
     //Clears the graph.
     files.clear();
+    delete headerCache;
+    headerCache = nullptr;
+    delete preamble;
+    preamble = nullptr;
+    if (astCache != nullptr) clangPrint->printASTCache(astCache->getNumHits(), astCache->getNumMisses());
+    delete astCache;
+    astCache = nullptr;
+    if (fileCache != nullptr) clangPrint->printFileCache(fileCache->getNumStatHits(), fileCache->getNumContentHits());
+    fileCache = nullptr;
+    fileSystem = nullptr;
+    delete prefetcher;
+    prefetcher = nullptr;
 
     //Returns the success code.
     delete clangPrint;
@@ -291,47 +398,70 @@ bool ClangDriver::processAllFiles(bool blobMode, string mergeFile, bool lowMemor
 }
 
 /**
- * Conducts analysis on the files to generate a model.
- * @param blobMode Blob mode toggle.
+ * Conducts analysis on the files to generate a model. Every profile gets its
+ * own walker and graph but all of them share a single parse.
+ * @param profiles The output profiles.
  * @param lowMemory Low memory mode toggle.
- * @param mergeGraph Graph to merge in.
+ * @param mergeGraphs Graphs to merge in. One per profile.
  * @param i The starting file.
  * @param clangPrint System to print messages.
- * @param exclude Items to exclude.
  * @param OptionsParser ClangEx options.
+ * @param settings The generation settings.
  * @return Whether the analysis was successful.
  */
-bool ClangDriver::runAnalysis(bool blobMode, bool lowMemory, TAGraph* mergeGraph, int i, Printer* clangPrint,
-                              TAGraph::ClangExclude exclude, CommonOptionsParser* OptionsParser) {
-    ASTWalker *walker;
-    unique_ptr<FrontendActionFactory> act;
+bool ClangDriver::runAnalysis(vector<Profile> profiles, bool lowMemory, vector<TAGraph*> mergeGraphs, int i,
+                              Printer* clangPrint, CommonOptionsParser* OptionsParser, GenerateSettings settings) {
+    vector<ASTWalker*> walkers;
     bool success = true;
 
     vector<string> curList;
     curList.push_back(files.at(i).string());
+    vector<string> sources = (lowMemory || settings.isolate) ? curList : OptionsParser->getSourcePathList();
 
-    if (lowMemory) dynamic_cast<LowMemoryTAGraph*>(mergeGraph)->dumpCurrentFile(i, files.at(i).string());
+    if (lowMemory) {
+        for (auto graph : mergeGraphs) dynamic_cast<LowMemoryTAGraph*>(graph)->dumpCurrentFile(i, files.at(i).string());
+    }
 
     //Sets up the processor.
-    ClangTool* Tool = new ClangTool(OptionsParser->getCompilations(),
-                                    (lowMemory) ? curList : OptionsParser->getSourcePathList());
-
-    if (blobMode) {
-        walker = new BlobWalker(clangPrint, lowMemory, exclude, mergeGraph);
-    } else {
-        walker = new PartialWalker(clangPrint, lowMemory, exclude, mergeGraph);
+    ClangTool* Tool = new ClangTool(OptionsParser->getCompilations(), sources,
+                                    make_shared<clang::PCHContainerOperations>(), fileSystem);
+
+    for (int p = 0; p < profiles.size(); p++) {
+        TAGraph::ClangExclude exclude = profiles.at(p).exclude;
+        if (profiles.at(p).blobMode && settings.visitorMode) {
+            walkers.push_back(new VisitorWalker(clangPrint, lowMemory, exclude, mergeGraphs.at(p)));
+        } else if (profiles.at(p).blobMode) {
+            walkers.push_back(new BlobWalker(clangPrint, lowMemory, exclude, mergeGraphs.at(p)));
+        } else {
+            walkers.push_back(new PartialWalker(clangPrint, lowMemory, exclude, mergeGraphs.at(p)));
+        }
+        walkers.at(p)->setPrintFiles(p == 0);
     }
 
+    //Parses against the precompiled preamble where the flags match.
+    if (preamble != nullptr) Tool->appendArgumentsAdjuster(preamble->getAdjuster());
+
+    //Skips function bodies when only declarations are needed.
+    vector<string> extraArgs = getExtraArguments(settings);
+    if (extraArgs.size() > 0) Tool->appendArgumentsAdjuster(getInsertArgumentAdjuster(extraArgs, ArgumentInsertPosition::END));
+
+    //Sets up the traversal scope.
+    ScopeFilter filter(settings.includeGlobs, settings.excludeGlobs, settings.pruneSystemHeaders, headerCache,
+                       settings.traversal);
+
     //Generates a matcher system.
     MatchFinder finder;
 
-    //Next, processes the matching conditions.
-    walker->generateASTMatches(&finder);
+    //Next, processes the matching conditions. All walkers share the finder.
+    for (auto walker : walkers){
+        walker->setDeclsOnly(settings.declsOnly);
+        walker->setScopeFilter(&filter);
+        walker->generateASTMatches(&finder);
+    }
 
     //Runs the Clang tool.
-    act = newFrontendActionFactory(&finder);
-    int code = Tool->run(act.get());
-    act.reset();
+    ExtractActionFactory act(&finder, walkers, &filter, prefetcher);
+    int code = (astCache != nullptr) ? runCachedTool(sources, OptionsParser, settings, &act) : Tool->run(&act);
     clangPrint->printFileNameDone();
 
     //Gets the code and checks for warnings.
@@ -340,12 +470,324 @@ bool ClangDriver::runAnalysis(bool blobMode, bool lowMemory, TAGraph* mergeGraph
         success = false;
     }
 
-    delete walker;
+    for (auto walker : walkers) delete walker;
     delete Tool;
 
     return success;
 }
 
+/**
+ * Runs the matchers over the files using the AST cache. Files that miss
+ * the cache are parsed and their ASTs are stored for later runs.
+ * @param sources The files to process.
+ * @param OptionsParser ClangEx options.
+ * @param settings The generation settings.
+ * @param act The extraction action to run.
+ * @return The result code. Non-zero if any file failed to parse.
+ */
+int ClangDriver::runCachedTool(vector<string> sources, CommonOptionsParser* OptionsParser, GenerateSettings settings,
+                               ExtractActionFactory* act){
+    int code = 0;
+    vector<string> extraArgs = getExtraArguments(settings);
+
+    for (string source : sources){
+        if (prefetcher != nullptr) prefetcher->advance(source);
+
+        vector<CompileCommand> commands = OptionsParser->getCompilations().getCompileCommands(source);
+        string key = (commands.size() == 0) ? string() : astCache->generateKey(source, commands.at(0), extraArgs);
+
+        //Parses the file on a miss and stores it.
+        unique_ptr<clang::ASTUnit> unit = astCache->load(key);
+        if (unit == nullptr){
+            ClangTool tool(OptionsParser->getCompilations(), vector<string>{source},
+                           make_shared<clang::PCHContainerOperations>(), fileSystem);
+            if (extraArgs.size() > 0) {
+                tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(extraArgs, ArgumentInsertPosition::END));
+            }
+
+            vector<unique_ptr<clang::ASTUnit>> units;
+            int result = tool.buildASTs(units);
+            if (result != 0) code = result;
+            if (units.size() == 0) continue;
+
+            unit = move(units.at(0));
+            if (!unit->getDiagnostics().hasErrorOccurred()) astCache->save(key, unit.get());
+        }
+
+        act->runOnUnit(unit.get());
+    }
+
+    return code;
+}
+
+/**
+ * Gets the arguments that are added to every compile command.
+ * @param settings The generation settings.
+ * @return The extra arguments.
+ */
+vector<string> ClangDriver::getExtraArguments(GenerateSettings settings){
+    vector<string> extraArgs;
+    if (settings.declsOnly){
+        extraArgs.push_back("-Xclang");
+        extraArgs.push_back("-skip-function-bodies");
+    }
+
+    return extraArgs;
+}
+
+/**
+ * Loads the source snapshot, building it first if it doesn't exist yet.
+ * @param snapshotFile The snapshot file.
+ * @param OptionsParser ClangEx options.
+ * @param clangPrint System to print messages.
+ * @return Whether the snapshot is being used.
+ */
+bool ClangDriver::loadSnapshot(string snapshotFile, CommonOptionsParser* OptionsParser, Printer* clangPrint){
+    bool built = false;
+    if (!exists(snapshotFile)){
+        if (!SnapshotFileSystem::build(snapshotFile, getSnapshotRoots(OptionsParser))) return false;
+        built = true;
+    }
+
+    llvm::IntrusiveRefCntPtr<SnapshotFileSystem> snapshot(new SnapshotFileSystem(fileSystem));
+    if (!snapshot->load(snapshotFile)) return false;
+
+    //Falls back to the real files when the sources changed since the snapshot was built.
+    vector<string> mainFiles;
+    for (path file : files) mainFiles.push_back(absolute(file).string());
+    if (!snapshot->isCurrent(mainFiles)) return false;
+
+    clangPrint->printSnapshot(snapshot->getNumFiles(), built);
+    fileSystem = snapshot;
+    return true;
+}
+
+/**
+ * Gets the directories that go in the snapshot. These are the directories of
+ * the source files and every include directory in their compile commands.
+ * @param OptionsParser ClangEx options.
+ * @return The snapshot directories.
+ */
+vector<path> ClangDriver::getSnapshotRoots(CommonOptionsParser* OptionsParser){
+    const vector<string> INCLUDE_FLAGS = {"-I", "-isystem", "-iquote", "-idirafter"};
+    unordered_set<string> seen;
+    vector<path> roots;
+
+    for (path file : files){
+        path dir = absolute(file).parent_path();
+        if (seen.insert(dir.string()).second) roots.push_back(dir);
+
+        for (CompileCommand command : OptionsParser->getCompilations().getCompileCommands(file.string())){
+            for (size_t i = 0; i < command.CommandLine.size(); i++){
+                string arg = command.CommandLine.at(i);
+                for (string flag : INCLUDE_FLAGS){
+                    if (arg.compare(0, flag.size(), flag) != 0) continue;
+
+                    //The directory is either joined to the flag or the next argument.
+                    string includeDir = arg.substr(flag.size());
+                    if (includeDir.empty() && i + 1 < command.CommandLine.size()){
+                        includeDir = command.CommandLine.at(++i);
+                    }
+                    if (includeDir.empty()) break;
+
+                    path includePath = absolute(includeDir, command.Directory);
+                    if (seen.insert(includePath.string()).second) roots.push_back(includePath);
+                    break;
+                }
+            }
+        }
+    }
+
+    return roots;
+}
+
+/**
+ * Runs each file in its own forked worker. Workers send their facts back and the
+ * facts are merged in file order. Files whose worker crashes or times out are
+ * skipped and still count as done so a resumed run doesn't retry them. Workers
+ * stop being started while too many results wait behind a slow file.
+ * @param profiles The output profiles.
+ * @param lowMemory Low memory mode toggle.
+ * @param mergeGraphs Graphs to merge in. One per profile.
+ * @param startNum The first file to process.
+ * @param completed Files that were completed by an earlier run.
+ * @param clangPrint System to print messages.
+ * @param OptionsParser ClangEx options.
+ * @param settings The generation settings.
+ * @return Whether the analysis was successful. Fails if output couldn't be merged or every file failed.
+ */
+bool ClangDriver::runIsolatedAnalysis(vector<Profile> profiles, bool lowMemory, vector<TAGraph*> mergeGraphs,
+                                      int startNum, unordered_set<int> completed, Printer* clangPrint,
+                                      CommonOptionsParser* OptionsParser, GenerateSettings settings){
+    WorkerPool pool(settings.numJobs, settings.timeout);
+    map<int, WorkerPool::Result> finished;
+    int nextFile = startNum;
+    int nextMerge = startNum;
+    int maxPending = settings.numJobs * WORKER_PENDING_FACTOR;
+    int numAttempted = 0;
+    int numFailed = 0;
+    bool success = true;
+
+    while (nextFile < getNumFiles() || !pool.isEmpty()){
+        //Starts workers until the pool is full or too many results are waiting to be merged.
+        while (nextFile < getNumFiles() && !pool.isFull() && (int) finished.size() < maxPending){
+            int i = nextFile++;
+            if (completed.find(i) != completed.end()) continue;
+
+            if (prefetcher != nullptr) prefetcher->advance(files.at(i).string());
+            bool started = pool.spawn(i, [&, i](int fd) {
+                runIsolatedFile(profiles, i, fd, clangPrint, OptionsParser, settings);
+            });
+            if (!started) finished[i] = WorkerPool::Result{i, WorkerPool::FAILED, 0, string()};
+        }
+        for (auto result : pool.wait()) finished[result.id] = result;
+
+        //Merges the results in file order so the model matches a serial run.
+        while (nextMerge < nextFile){
+            if (completed.find(nextMerge) != completed.end()){
+                nextMerge++;
+                continue;
+            }
+            auto it = finished.find(nextMerge);
+            if (it == finished.end()) break;
+            WorkerPool::Result &result = it->second;
+
+            string fileName = files.at(nextMerge).string();
+            if (lowMemory) {
+                for (auto graph : mergeGraphs) {
+                    dynamic_cast<LowMemoryTAGraph*>(graph)->dumpCurrentFile(nextMerge, fileName);
+                }
+            }
+
+            //Only complete output is merged. Partial facts from a failed worker are dropped.
+            bool merged = result.status == WorkerPool::FINISHED && mergeWorkerOutput(result.output, mergeGraphs);
+            numAttempted++;
+            if (!merged){
+                string reason = "failed";
+                if (result.status == WorkerPool::FINISHED){
+                    reason = "sent output that could not be merged";
+                    success = false;
+                } else if (result.status == WorkerPool::CRASHED){
+                    reason = "crashed with signal " + to_string(result.signal);
+                } else if (result.status == WorkerPool::TIMED_OUT){
+                    reason = "timed out after " + to_string(settings.timeout) + " second(s)";
+                }
+                clangPrint->printWorkerFailure(fileName, reason);
+                numFailed++;
+            }
+
+            if (lowMemory) {
+                for (auto graph : mergeGraphs) dynamic_cast<LowMemoryTAGraph*>(graph)->commitFile(nextMerge, fileName);
+            }
+            finished.erase(it);
+            nextMerge++;
+        }
+    }
+    if (lowMemory) {
+        for (auto graph : mergeGraphs) dynamic_cast<LowMemoryTAGraph*>(graph)->flushJournal();
+    }
+
+    if (numFailed > 0) clangPrint->printWorkersSkipped(numFailed);
+    if (numAttempted > 0 && numFailed == numAttempted) success = false;
+    return success;
+}
+
+/**
+ * Processes a single file inside a worker and writes its facts to the parent.
+ * Each graph is sent as a block followed by the headers the file extracted.
+ * @param profiles The output profiles.
+ * @param i The file to process.
+ * @param fd The pipe to the parent.
+ * @param clangPrint System to print messages.
+ * @param OptionsParser ClangEx options.
+ * @param settings The generation settings.
+ */
+void ClangDriver::runIsolatedFile(vector<Profile> profiles, int i, int fd, Printer* clangPrint,
+                                  CommonOptionsParser* OptionsParser, GenerateSettings settings){
+    //The prefetch thread only exists in the parent.
+    prefetcher = nullptr;
+    if (headerCache != nullptr) headerCache->startLog();
+
+    //Workers only parse the file they were given.
+    settings.isolate = true;
+
+    vector<TAGraph*> workerGraphs;
+    for (int p = 0; p < profiles.size(); p++) workerGraphs.push_back(new TAGraph());
+    runAnalysis(profiles, false, workerGraphs, i, clangPrint, OptionsParser, settings);
+
+    //Sends each block with its length so the contents don't need escaping.
+    string output;
+    for (int p = 0; p < workerGraphs.size(); p++){
+        string facts = workerGraphs.at(p)->generateFacts();
+        output += WORKER_GRAPH + "\t" + to_string(p) + "\t" + to_string(facts.size()) + "\n" + facts;
+    }
+    if (headerCache != nullptr){
+        for (string key : headerCache->getLog()){
+            output += WORKER_HEADER + "\t" + to_string(key.size()) + "\n" + key;
+        }
+    }
+    output += WORKER_END;
+
+    WorkerPool::writeAll(fd, output);
+}
+
+/**
+ * Merges the output of a worker into the graphs. Nothing is merged unless
+ * the worker sent all of its output and every fact in it is well formed.
+ * @param output The output of the worker.
+ * @param mergeGraphs The graphs to merge into. One per profile.
+ * @return Whether the output was merged.
+ */
+bool ClangDriver::mergeWorkerOutput(string output, vector<TAGraph*> mergeGraphs){
+    if (output.size() < WORKER_END.size() ||
+            output.compare(output.size() - WORKER_END.size(), WORKER_END.size(), WORKER_END) != 0) return false;
+
+    //Splits the output into its blocks.
+    vector<pair<int, string>> blocks;
+    vector<string> headers;
+    size_t pos = 0;
+    size_t end = output.size() - WORKER_END.size();
+    while (pos < end){
+        size_t lineEnd = output.find('\n', pos);
+        if (lineEnd == string::npos || lineEnd >= end) return false;
+        vector<string> fields;
+        string line = output.substr(pos, lineEnd - pos);
+        boost::split(fields, line, boost::is_any_of("\t"));
+        pos = lineEnd + 1;
+
+        size_t length;
+        try {
+            length = stoull(fields.back());
+        } catch (...) {
+            return false;
+        }
+        if (pos + length > end) return false;
+
+        if (fields.at(0).compare(WORKER_GRAPH) == 0 && fields.size() == 3){
+            int p = atoi(fields.at(1).c_str());
+            if (p < 0 || p >= mergeGraphs.size()) return false;
+            blocks.push_back(make_pair(p, output.substr(pos, length)));
+        } else if (fields.at(0).compare(WORKER_HEADER) == 0 && fields.size() == 2){
+            headers.push_back(output.substr(pos, length));
+        } else {
+            return false;
+        }
+        pos += length;
+    }
+
+    //Checks every block before any facts are added.
+    vector<vector<TAGraph::Fact>> parsed(blocks.size());
+    for (size_t b = 0; b < blocks.size(); b++){
+        if (!mergeGraphs.at(blocks.at(b).first)->parseFacts(blocks.at(b).second, &parsed.at(b))) return false;
+    }
+
+    //Adds the facts and marks the headers as extracted for later workers.
+    for (size_t b = 0; b < blocks.size(); b++) mergeGraphs.at(blocks.at(b).first)->applyFacts(parsed.at(b));
+    if (headerCache != nullptr) headerCache->commit(headers);
+
+    return true;
+}
+
 /**
  * Recovers a low memory run. Only resolves.
  * @param startDir The starting directory.
@@ -367,15 +809,96 @@ bool ClangDriver::recoverCompact(string startDir){
 
     Printer* clangPrint = new Printer();
 
-    //Now, we iterate and compact each graph.
-    for (int gNum : graphNums){
-        TAGraph* cur = new LowMemoryTAGraph(startDir, gNum);
-        cur->resolveExternalReferences(clangPrint, false);
-        cur->resolveFiles(toggle);
-        graphs.push_back(cur);
+    //Sizes the worker pool.
+    int numWorkers = (int) thread::hardware_concurrency();
+    if (numWorkers < 1) numWorkers = 1;
+    if (numWorkers > (int) graphNums.size()) numWorkers = (int) graphNums.size();
+
+    //The workers share the cores when building their file trees.
+    int treeThreads = max((int) thread::hardware_concurrency() / numWorkers, 1);
+    unsigned long long memBudget = getAvailableMemory() / COMPACT_MEM_SHARE;
+    clangPrint->printCompactStart((int) graphNums.size(), numWorkers);
+
+    //Worker state.
+    vector<LowMemoryTAGraph*> compacted(graphNums.size(), nullptr);
+    vector<int> succeeded(graphNums.size(), 0);
+    mutex poolLock;
+    condition_variable poolCond;
+    size_t nextGraph = 0;
+    unsigned long long inFlight = 0;
+    int numRunning = 0;
+
+    //Each worker compacts graphs until none are left.
+    auto compactWorker = [&](){
+        while (true){
+            size_t cur;
+            unsigned long long cost;
+            {
+                lock_guard<mutex> lock(poolLock);
+                if (nextGraph >= graphNums.size()) return;
+                cur = nextGraph++;
+            }
+
+            //Sizes the spill files without holding the lock.
+            cost = estimateCompactMemory(startDir, graphNums.at(cur));
+            {
+                unique_lock<mutex> lock(poolLock);
+
+                //Waits until the graph fits in memory. A lone graph always runs.
+                poolCond.wait(lock, [&]{ return numRunning == 0 || inFlight + cost <= memBudget; });
+                inFlight += cost;
+                numRunning++;
+            }
+
+            LowMemoryTAGraph* graph = new LowMemoryTAGraph(startDir, graphNums.at(cur));
+            try {
+                if (graph->compactSpillFiles(clangPrint, true)){
+                    graph->resolveFiles(toggle, treeThreads);
+                    succeeded.at(cur) = 1;
+                }
+            } catch (std::exception& e) {
+                succeeded.at(cur) = 0;
+            }
+            compacted.at(cur) = graph;
+
+            {
+                lock_guard<mutex> lock(poolLock);
+                inFlight -= cost;
+                numRunning--;
+            }
+            poolCond.notify_all();
+        }
+    };
+
+    vector<thread> workers;
+    for (int i = 0; i < numWorkers; i++) workers.push_back(thread(compactWorker));
+    for (thread& worker : workers) worker.join();
+
+    //Aggregates the reports.
+    bool success = true;
+    int totalResolved = 0;
+    int totalUnresolved = 0;
+    for (int i = 0; i < graphNums.size(); i++){
+        LowMemoryTAGraph* graph = compacted.at(i);
+        clangPrint->printCompactDone(graphNums.at(i), succeeded.at(i) == 1, graph->getNumResolved(),
+                                     graph->getNumUnresolved());
+
+        //Compaction only replaces the spill files once it succeeds so failed graphs can be compacted again.
+        if (succeeded.at(i) != 1){
+            graph->keepSpillFiles();
+            delete graph;
+            success = false;
+            continue;
+        }
+
+        totalResolved += graph->getNumResolved();
+        totalUnresolved += graph->getNumUnresolved();
+        graphs.push_back(graph);
     }
+    clangPrint->printResolveRefDone(totalResolved, totalUnresolved);
 
-    return true;
+    delete clangPrint;
+    return success;
 }
 
 /**
@@ -397,13 +920,13 @@ bool ClangDriver::recoverFull(string startDir){
         return false;
     }
 
-    vector<string> ldFiles;
-    bool blobMode;
-    TAGraph::ClangExclude ldExclude;
-
     for (int gNum : graphNums){
+        vector<string> ldFiles;
+        bool blobMode = false;
+        TAGraph::ClangExclude ldExclude;
+        GenerateSettings ldSettings;
         bool succ = readSettings(startDir + "/" + to_string(gNum) + "-" + LowMemoryTAGraph::CUR_SETTING_LOC, &ldFiles,
-                                 &blobMode, &ldExclude);
+                                 &blobMode, &ldExclude, &ldSettings);
         if (!succ) {
             cerr << "Recovery Error: Settings could not be read for this file." << endl;
             return false;
@@ -416,13 +939,14 @@ bool ClangDriver::recoverFull(string startDir){
 
         //Sets up the file system.
         recoveryMode = true;
+        recoveryNum = gNum;
         auto tempLowMem = lowMemoryPath;
         lowMemoryPath = startDir;
         files.clear();
         for (string curFile : ldFiles) files.push_back(path(curFile));
         toggle = ldExclude;
 
-        bool code = processAllFiles(blobMode, "", true, startNum);
+        bool code = processAllFiles(blobMode, "", true, ldSettings, startNum);
 
         //Restores the system.
         recoveryMode = false;
@@ -565,6 +1089,9 @@ bool ClangDriver::changeLowMemoryLoc(path curLoc){
             rename(srcRoot + LowMemoryTAGraph::BASE_INSTANCE_FN, dstRoot + LowMemoryTAGraph::BASE_INSTANCE_FN);
             rename(srcRoot + LowMemoryTAGraph::BASE_RELATION_FN, dstRoot + LowMemoryTAGraph::BASE_RELATION_FN);
             rename(srcRoot + LowMemoryTAGraph::BASE_ATTRIBUTE_FN, dstRoot + LowMemoryTAGraph::BASE_ATTRIBUTE_FN);
+            rename(srcRoot + LowMemoryTAGraph::BASE_FILE_INDEX_FN, dstRoot + LowMemoryTAGraph::BASE_FILE_INDEX_FN);
+            if (exists(srcRoot + LowMemoryTAGraph::BASE_JOURNAL_FN))
+                rename(srcRoot + LowMemoryTAGraph::BASE_JOURNAL_FN, dstRoot + LowMemoryTAGraph::BASE_JOURNAL_FN);
 
             dynamic_cast<LowMemoryTAGraph*>(graphs.at(cur))->changeRoot(curLoc.string());
         }
@@ -759,22 +1286,8 @@ vector<string> ClangDriver::getDisabled(){
  * @return Success or failure of the output.
  */
 bool ClangDriver::outputTAString(int modelNum, string fileName){
-    //First, runs the graph builder process.
-    string tupleAttribute = graphs.at(modelNum)->generateTAFormat();
-
-    //Next, writes to disk.
-    std::ofstream taFile;
-    taFile.open(fileName.c_str());
-
-    //Check if the file is opened.
-    if (!taFile.is_open()){
-        return false;
-    }
-
-    taFile << tupleAttribute;
-    taFile.close();
-
-    return true;
+    //Streams the graph directly to disk.
+    return graphs.at(modelNum)->writeTAFormat(fileName);
 }
 
 /**
@@ -832,16 +1345,87 @@ vector<int> ClangDriver::getLMGraphs(string startDir){
     return results;
 }
 
+/**
+ * Estimates the memory needed to compact a low memory graph. Compaction
+ * holds the instances and attributes of a graph in memory.
+ * @param startDir The directory holding the graph.
+ * @param gNum The graph number.
+ * @return The estimated number of bytes.
+ */
+unsigned long long ClangDriver::estimateCompactMemory(string startDir, int gNum){
+    unsigned long long size = 0;
+    string root = startDir + "/" + to_string(gNum) + "-";
+
+    boost::system::error_code ec;
+    for (string fN : {LowMemoryTAGraph::BASE_INSTANCE_FN, LowMemoryTAGraph::BASE_ATTRIBUTE_FN}){
+        auto curSize = file_size(root + fN, ec);
+        if (!ec) size += curSize;
+    }
+
+    return size * COMPACT_MEM_FACTOR;
+}
+
+/**
+ * Gets the amount of physical memory currently available. Uses MemAvailable since
+ * it counts the page cache that can be reclaimed. Falls back to the free pages.
+ * @return The number of bytes available.
+ */
+unsigned long long ClangDriver::getAvailableMemory(){
+    std::ifstream meminfo("/proc/meminfo");
+    string line;
+    while (meminfo.is_open() && getline(meminfo, line)){
+        if (line.compare(0, 13, "MemAvailable:") != 0) continue;
+
+        //The value is given in kB.
+        unsigned long long kb = strtoull(line.c_str() + 13, nullptr, 10);
+        if (kb > 0) return kb * 1024;
+        break;
+    }
+
+    long pages = sysconf(_SC_AVPHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages <= 0 || pageSize <= 0) return 0;
+
+    return (unsigned long long) pages * (unsigned long long) pageSize;
+}
+
+/**
+ * Generates the lines that store the generation settings of a low memory run.
+ * Output profiles aren't stored since each profile is recovered as its own graph.
+ * @param settings The generation settings.
+ * @return The setting lines.
+ */
+vector<string> ClangDriver::generateSettingLines(GenerateSettings settings){
+    vector<string> lines;
+    lines.push_back("jobs " + to_string(settings.numJobs));
+    lines.push_back("visitor " + to_string(settings.visitorMode));
+    for (string glob : settings.includeGlobs) lines.push_back("include " + glob);
+    for (string glob : settings.excludeGlobs) lines.push_back("exclude " + glob);
+    lines.push_back("pruneSystemHeaders " + to_string(settings.pruneSystemHeaders));
+    lines.push_back("headerCache " + to_string(settings.headerCache));
+    lines.push_back("pch " + to_string(settings.precompiledPreamble));
+    lines.push_back("declsOnly " + to_string(settings.declsOnly));
+    if (!settings.astCacheDir.empty()) lines.push_back("astCache " + settings.astCacheDir);
+    lines.push_back("traversal " + to_string(settings.traversal));
+    if (!settings.snapshotFile.empty()) lines.push_back("snapshot " + settings.snapshotFile);
+    lines.push_back("prefetch " + to_string(settings.prefetchDepth));
+    lines.push_back("isolate " + to_string(settings.isolate));
+    lines.push_back("timeout " + to_string(settings.timeout));
+
+    return lines;
+}
+
 /**
  * Reads the setting file for a previous low memory run.
  * @param loc The location to read.
  * @param files The files in the setting.
  * @param blobMode The blob mode toggle in the settings.
  * @param exclude The exclusions in the settings.
+ * @param settings The generation settings.
  * @return Whether the read was successful.
  */
 bool ClangDriver::readSettings(string loc, vector<string>* files, bool* blobMode,
-                               TAGraph::ClangExclude* exclude){
+                               TAGraph::ClangExclude* exclude, GenerateSettings* settings){
     std::ifstream settingFile(loc);
     if (!settingFile.is_open()) return false;
 
@@ -855,6 +1439,29 @@ bool ClangDriver::readSettings(string loc, vector<string>* files, bool* blobMode
     //Get the booleans.
     string booleans;
     getline(settingFile, booleans);
+
+    //Gets the generation settings. Each line is a key followed by its value.
+    string setting;
+    while (getline(settingFile, setting)){
+        size_t split = setting.find(' ');
+        string key = setting.substr(0, split);
+        string value = (split == string::npos) ? string() : setting.substr(split + 1);
+
+        if (key.compare("jobs") == 0) settings->numJobs = atoi(value.c_str());
+        else if (key.compare("visitor") == 0) settings->visitorMode = value.compare("1") == 0;
+        else if (key.compare("include") == 0) settings->includeGlobs.push_back(value);
+        else if (key.compare("exclude") == 0) settings->excludeGlobs.push_back(value);
+        else if (key.compare("pruneSystemHeaders") == 0) settings->pruneSystemHeaders = value.compare("1") == 0;
+        else if (key.compare("headerCache") == 0) settings->headerCache = value.compare("1") == 0;
+        else if (key.compare("pch") == 0) settings->precompiledPreamble = value.compare("1") == 0;
+        else if (key.compare("declsOnly") == 0) settings->declsOnly = value.compare("1") == 0;
+        else if (key.compare("astCache") == 0) settings->astCacheDir = value;
+        else if (key.compare("traversal") == 0) settings->traversal = (TraversalPolicy) atoi(value.c_str());
+        else if (key.compare("snapshot") == 0) settings->snapshotFile = value;
+        else if (key.compare("prefetch") == 0) settings->prefetchDepth = atoi(value.c_str());
+        else if (key.compare("isolate") == 0) settings->isolate = value.compare("1") == 0;
+        else if (key.compare("timeout") == 0) settings->timeout = atoi(value.c_str());
+    }
     settingFile.close();
 
     stringstream sstream = stringstream(booleans);
@@ -959,4 +1566,34 @@ vector<string> ClangDriver::splitList(std::string list) {
     }
 
     return result;
-}
\ No newline at end of file
+}
+/**
+ * Sets a feature in a set of exclusions based on a string.
+ * @param exclude The exclusions to modify.
+ * @param feature The feature to set.
+ * @param excluded Whether the feature is excluded.
+ * @return Whether the feature was found.
+ */
+bool ClangDriver::setFeature(TAGraph::ClangExclude* exclude, string feature, bool excluded){
+    if (feature.compare("cSubSystem") == 0){
+        exclude->cSubSystem = excluded;
+    } else if (feature.compare("cVariable") == 0){
+        exclude->cVariable = excluded;
+    } else if (feature.compare("cUnion") == 0){
+        exclude->cUnion = excluded;
+    } else if (feature.compare("cStruct") == 0){
+        exclude->cStruct = excluded;
+    } else if (feature.compare("cFunction") == 0){
+        exclude->cFunction = excluded;
+    } else if (feature.compare("cFile") == 0){
+        exclude->cFile = excluded;
+    } else if (feature.compare("cEnum") == 0){
+        exclude->cEnum = excluded;
+    } else if (feature.compare("cClass") == 0){
+        exclude->cClass = excluded;
+    } else {
+        return false;
+    }
+
+    return true;
+}
@@ -29,14 +29,53 @@
 
 #include <vector>
 #include <string>
+#include <unordered_set>
 #include <boost/filesystem.hpp>
 #include "clang/Tooling/CommonOptionsParser.h"
+#include "clang/Basic/VirtualFileSystem.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "../Graph/TAGraph.h"
+#include "../Graph/LowMemoryTAGraph.h"
 
 using namespace boost::filesystem;
 
+class HeaderCache;
+class PCHBuilder;
+class ASTCache;
+class CachedFileSystem;
+class FilePrefetcher;
+class ExtractActionFactory;
+
 class ClangDriver {
 public:
+    /** Traversal Policies */
+    enum TraversalPolicy {SPELLED, COLLAPSED, FULL};
+
+    /** Output Profile */
+    typedef struct {
+        bool blobMode;
+        TAGraph::ClangExclude exclude;
+    } Profile;
+
+    /** Generation Settings */
+    typedef struct {
+        int numJobs = 1;
+        bool visitorMode = false;
+        std::vector<std::string> includeGlobs;
+        std::vector<std::string> excludeGlobs;
+        bool pruneSystemHeaders = true;
+        bool headerCache = false;
+        bool precompiledPreamble = false;
+        bool declsOnly = false;
+        std::string astCacheDir;
+        std::vector<Profile> profiles;
+        TraversalPolicy traversal = FULL;
+        std::string snapshotFile;
+        int prefetchDepth = 4;
+        bool isolate = false;
+        int timeout = 0;
+    } GenerateSettings;
+
     /** Constructor/Destructor */
     ClangDriver();
     ~ClangDriver();
@@ -55,9 +94,11 @@ public:
     /** Enable/Disable Features */
     bool enableFeature(std::string feature);
     bool disableFeature(std::string feature);
+    bool addProfile(std::string spec, GenerateSettings* settings);
 
     /** ClangEx Runner */
-    bool processAllFiles(bool blobMode, std::string mergeFile, bool lowMemory, int startNum = 0);
+    bool processAllFiles(bool blobMode, std::string mergeFile, bool lowMemory,
+                         GenerateSettings settings = GenerateSettings(), int startNum = 0);
     bool recoverCompact(std::string startDir);
     bool recoverFull(std::string startDir);
 
@@ -83,6 +124,14 @@ private:
     const std::string INCLUDE_DIR_LOC = "--extra-arg=-I" + INCLUDE_DIR;
     const int BASE_LEN = 2;
     const int FILE_SPLIT = 1;
+    const int COMPACT_MEM_FACTOR = 4;
+    const int COMPACT_MEM_SHARE = 2;
+    const size_t FILE_CACHE_SIZE = 256 * 1024 * 1024;
+    const std::string TRAVERSAL_NAMES[3] = {"spelled", "collapsed", "full"};
+    const std::string WORKER_GRAPH = "G";
+    const std::string WORKER_HEADER = "H";
+    const std::string WORKER_END = "END\n";
+    const int WORKER_PENDING_FACTOR = 2;
 
     /** Private Variables */
     std::vector<TAGraph*> graphs;
@@ -90,6 +139,13 @@ private:
     std::vector<std::string> ext;
     path lowMemoryPath = "";
     bool recoveryMode = false;
+    int recoveryNum = 0;
+    HeaderCache* headerCache = nullptr;
+    PCHBuilder* preamble = nullptr;
+    ASTCache* astCache = nullptr;
+    llvm::IntrusiveRefCntPtr<CachedFileSystem> fileCache;
+    llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> fileSystem;
+    FilePrefetcher* prefetcher = nullptr;
 
     /** Toggle System */
     std::string langString = "\tcSubSystem\n\tcFile\n\tcClass\n\tcFunction\n\tcVariable\n\tcEnum\n\tcStruct\n\tcUnion\n";
@@ -106,8 +162,24 @@ private:
     int removeFile(path file);
     int removeDirectory(path directory);
 
-    bool runAnalysis(bool blobMode, bool lowMemory, TAGraph* mergeGraph, int i, Printer* clangPrint,
-                     TAGraph::ClangExclude exclude, clang::tooling::CommonOptionsParser* OptionsParser);
+    bool runAnalysis(std::vector<Profile> profiles, bool lowMemory, std::vector<TAGraph*> mergeGraphs, int i,
+                     Printer* clangPrint, clang::tooling::CommonOptionsParser* OptionsParser,
+                     GenerateSettings settings);
+    int runCachedTool(std::vector<std::string> sources, clang::tooling::CommonOptionsParser* OptionsParser,
+                      GenerateSettings settings, ExtractActionFactory* act);
+    std::vector<std::string> getExtraArguments(GenerateSettings settings);
+    bool loadSnapshot(std::string snapshotFile, clang::tooling::CommonOptionsParser* OptionsParser,
+                      Printer* clangPrint);
+    std::vector<boost::filesystem::path> getSnapshotRoots(clang::tooling::CommonOptionsParser* OptionsParser);
+    bool runIsolatedAnalysis(std::vector<Profile> profiles, bool lowMemory, std::vector<TAGraph*> mergeGraphs,
+                             int startNum, std::unordered_set<int> completed, Printer* clangPrint,
+                             clang::tooling::CommonOptionsParser* OptionsParser, GenerateSettings settings);
+    void runIsolatedFile(std::vector<Profile> profiles, int i, int fd, Printer* clangPrint,
+                         clang::tooling::CommonOptionsParser* OptionsParser, GenerateSettings settings);
+    bool mergeWorkerOutput(std::string output, std::vector<TAGraph*> mergeGraphs);
+
+    /** Feature Helpers */
+    bool setFeature(TAGraph::ClangExclude* exclude, std::string feature, bool excluded);
 
     /** Enabled Strings */
     std::vector<std::string> getEnabled();
@@ -120,8 +192,11 @@ private:
     /** Recovery Helper */
     std::vector<int> getLMGraphs(std::string startDir);
     bool readSettings(std::string file, std::vector<std::string>* files, bool* blobMode,
-                      TAGraph::ClangExclude* exclude);
+                      TAGraph::ClangExclude* exclude, GenerateSettings* settings);
+    std::vector<std::string> generateSettingLines(GenerateSettings settings);
     int readStartNum(std::string file);
+    unsigned long long estimateCompactMemory(std::string startDir, int gNum);
+    unsigned long long getAvailableMemory();
 
     /** Argument Helpers */
     int extractIntegerWords(std::string str);
@@ -0,0 +1,269 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PCHBuilder.cpp
+//
+// Finds the system includes shared at the top of every source file and
+// builds them into a precompiled header once. Files with the same flags
+// are then parsed against it. Everything else is parsed normally.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <boost/algorithm/string.hpp>
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Tooling/Tooling.h"
+#include "PCHBuilder.h"
+
+using namespace std;
+using namespace clang;
+using namespace clang::tooling;
+using namespace boost::filesystem;
+
+/**
+ * Creates a PCH builder.
+ * @param outputDir The directory the preamble and PCH are written to.
+ */
+PCHBuilder::PCHBuilder(path outputDir){
+    headerFile = absolute(outputDir / PREAMBLE_FN).string();
+    pchFile = absolute(outputDir / PCH_FN).string();
+}
+
+/**
+ * Removes the preamble and PCH.
+ */
+PCHBuilder::~PCHBuilder(){
+    boost::system::error_code ec;
+    boost::filesystem::remove(headerFile, ec);
+    boost::filesystem::remove(pchFile, ec);
+}
+
+/**
+ * Builds the PCH. Files are grouped by their compile flags and the largest group
+ * gets a PCH of the most common leading system includes. Only files that start
+ * with those includes are parsed against the PCH.
+ * @param files The files being processed.
+ * @param database The compilation database for the files.
+ * @return Whether a PCH was built.
+ */
+bool PCHBuilder::build(vector<path> files, const CompilationDatabase &database){
+    includes.clear();
+    pchFiles.clear();
+
+    //Groups the files by their compile flags.
+    unordered_map<string, vector<pair<CompileCommand, vector<string>>>> groups;
+    string bestKey;
+    for (path file : files){
+        vector<CompileCommand> commands = database.getCompileCommands(file.string());
+        if (commands.size() == 0) continue;
+
+        string key = generateFlagKey(commands.at(0));
+        groups[key].push_back(make_pair(commands.at(0), readIncludePrefix(file)));
+        if (groups.find(bestKey) == groups.end() || groups[key].size() > groups[bestKey].size()) bestKey = key;
+    }
+    if (groups.size() == 0) return false;
+
+    //Counts the files that start with each prefix of includes.
+    auto &group = groups[bestKey];
+    unordered_map<string, int> prefixCounts;
+    for (auto &entry : group){
+        string prefix;
+        for (string include : entry.second){
+            prefix += include + "\n";
+            prefixCounts[prefix]++;
+        }
+    }
+
+    //Picks the prefix that saves the most header parses.
+    size_t bestScore = 0;
+    for (auto &entry : group){
+        string prefix;
+        for (size_t i = 0; i < entry.second.size(); i++){
+            prefix += entry.second.at(i) + "\n";
+            size_t score = (size_t) prefixCounts[prefix] * (i + 1);
+            if (score <= bestScore) continue;
+
+            bestScore = score;
+            includes.assign(entry.second.begin(), entry.second.begin() + i + 1);
+        }
+    }
+    if (includes.size() == 0) return false;
+
+    //Writes the preamble.
+    ofstream header(headerFile);
+    if (!header.is_open()){
+        includes.clear();
+        return false;
+    }
+    for (string include : includes) header << "#include " << include << endl;
+    header.close();
+
+    //Builds the PCH with the flags of the group.
+    const CompileCommand &command = group.at(0).first;
+    vector<string> flags = normalizeFlags(command);
+    flags.push_back("-x");
+    flags.push_back((isCFile(command.Filename)) ? "c-header" : "c++-header");
+    flags.push_back("-o");
+    flags.push_back(pchFile);
+
+    FixedCompilationDatabase pchDatabase(command.Directory, flags);
+    ClangTool tool(pchDatabase, vector<string>{headerFile});
+    tool.clearArgumentsAdjusters();
+    unique_ptr<FrontendActionFactory> act = newFrontendActionFactory<GeneratePCHAction>();
+    if (tool.run(act.get()) != 0 || !exists(pchFile)){
+        includes.clear();
+        return false;
+    }
+
+    //Files that don't start with the prefix parse without the PCH.
+    for (auto &entry : group){
+        if (entry.second.size() < includes.size() ||
+                !equal(includes.begin(), includes.end(), entry.second.begin())) continue;
+        pchFiles.insert(entry.first.Filename);
+    }
+    return true;
+}
+
+/**
+ * Gets an adjuster that parses files in the PCH group against the PCH.
+ * @return The arguments adjuster.
+ */
+ArgumentsAdjuster PCHBuilder::getAdjuster(){
+    unordered_set<string> files = pchFiles;
+    string pch = pchFile;
+
+    return [files, pch](const CommandLineArguments &args, StringRef fileName) -> CommandLineArguments {
+        if (args.size() == 0 || files.find(fileName.str()) == files.end()) return args;
+
+        CommandLineArguments adjusted(args);
+        adjusted.insert(adjusted.begin() + 1, {"-include-pch", pch});
+        return adjusted;
+    };
+}
+
+/**
+ * Gets the number of includes in the PCH.
+ * @return The number of includes.
+ */
+int PCHBuilder::getNumIncludes(){
+    return (int) includes.size();
+}
+
+/**
+ * Gets the number of files parsed against the PCH.
+ * @return The number of files.
+ */
+int PCHBuilder::getNumFiles(){
+    return (int) pchFiles.size();
+}
+
+/**
+ * Reads the system includes at the top of a file. Stops at the first line
+ * that isn't a comment or a system include.
+ * @param file The file to read.
+ * @return The includes with their angle brackets.
+ */
+vector<string> PCHBuilder::readIncludePrefix(path file){
+    vector<string> prefix;
+    ifstream input(file.string());
+    if (!input.is_open()) return prefix;
+
+    string line;
+    bool inComment = false;
+    while (getline(input, line)){
+        boost::trim(line);
+
+        //Skips block comments.
+        if (inComment){
+            size_t end = line.find("*/");
+            if (end == string::npos) continue;
+            inComment = false;
+            line = boost::trim_copy(line.substr(end + 2));
+        }
+        if (line.compare(0, 2, "/*") == 0){
+            size_t end = line.find("*/", 2);
+            if (end == string::npos){
+                inComment = true;
+                continue;
+            }
+            line = boost::trim_copy(line.substr(end + 2));
+        }
+
+        //Skips line comments and blank lines.
+        if (line.empty() || line.compare(0, 2, "//") == 0) continue;
+
+        //Anything other than a system include ends the prefix.
+        if (line.at(0) != '#') break;
+        string directive = boost::trim_copy(line.substr(1));
+        if (directive.compare(0, 7, "include") != 0) break;
+
+        string target = boost::trim_copy(directive.substr(7));
+        size_t end = target.find('>');
+        if (target.empty() || target.at(0) != '<' || end == string::npos) break;
+        prefix.push_back(target.substr(0, end + 1));
+    }
+
+    return prefix;
+}
+
+/**
+ * Removes the compiler, the source file, and output flags from a compile command.
+ * @param command The compile command.
+ * @return The remaining flags.
+ */
+vector<string> PCHBuilder::normalizeFlags(const CompileCommand &command){
+    vector<string> flags;
+    path sourceFile = absolute(command.Filename, command.Directory);
+
+    for (size_t i = 1; i < command.CommandLine.size(); i++){
+        string arg = command.CommandLine.at(i);
+
+        //Skips output and dependency flags.
+        if (arg.compare("-o") == 0 || arg.compare("-MF") == 0 || arg.compare("-MT") == 0 || arg.compare("-MQ") == 0){
+            i++;
+            continue;
+        }
+        if (arg.compare("-c") == 0 || arg.compare("-M") == 0 || arg.compare("-MM") == 0 ||
+                arg.compare("-MD") == 0 || arg.compare("-MMD") == 0 || arg.compare("-MP") == 0) continue;
+
+        //Skips the source file.
+        if (arg.compare(command.Filename) == 0 || absolute(arg, command.Directory) == sourceFile) continue;
+
+        flags.push_back(arg);
+    }
+
+    return flags;
+}
+
+/**
+ * Generates a key for the flags a file is compiled with. Files can share a PCH if their keys match.
+ * @param command The compile command.
+ * @return The flag key.
+ */
+string PCHBuilder::generateFlagKey(const CompileCommand &command){
+    string key = command.Directory + "\n" + ((isCFile(command.Filename)) ? "c" : "c++") + "\n";
+    for (string flag : normalizeFlags(command)) key += flag + "\n";
+
+    return key;
+}
+
+/**
+ * Checks whether a file is compiled as C.
+ * @param fileName The name of the file.
+ * @return Whether the file is a C file.
+ */
+bool PCHBuilder::isCFile(string fileName){
+    return path(fileName).extension().string().compare(".c") == 0;
+}
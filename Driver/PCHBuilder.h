@@ -0,0 +1,65 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PCHBuilder.h
+//
+// Finds the system includes shared at the top of every source file and
+// builds them into a precompiled header once. Files with the same flags
+// are then parsed against it. Everything else is parsed normally.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CLANGEX_PCHBUILDER_H
+#define CLANGEX_PCHBUILDER_H
+
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include <boost/filesystem.hpp>
+#include "clang/Tooling/ArgumentsAdjusters.h"
+#include "clang/Tooling/CompilationDatabase.h"
+
+class PCHBuilder {
+public:
+    /** Constructor/Destructor */
+    PCHBuilder(boost::filesystem::path outputDir);
+    ~PCHBuilder();
+
+    /** PCH Generation */
+    bool build(std::vector<boost::filesystem::path> files, const clang::tooling::CompilationDatabase &database);
+
+    /** PCH Usage */
+    clang::tooling::ArgumentsAdjuster getAdjuster();
+    int getNumIncludes();
+    int getNumFiles();
+
+private:
+    /** Output Files */
+    const std::string PREAMBLE_FN = "clangex-preamble.h";
+    const std::string PCH_FN = "clangex-preamble.pch";
+    std::string headerFile;
+    std::string pchFile;
+
+    /** PCH Contents */
+    std::vector<std::string> includes;
+    std::unordered_set<std::string> pchFiles;
+
+    /** Helper Methods */
+    std::vector<std::string> readIncludePrefix(boost::filesystem::path file);
+    std::vector<std::string> normalizeFlags(const clang::tooling::CompileCommand &command);
+    std::string generateFlagKey(const clang::tooling::CompileCommand &command);
+    bool isCFile(std::string fileName);
+};
+
+
+#endif //CLANGEX_PCHBUILDER_H
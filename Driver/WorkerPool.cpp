@@ -0,0 +1,220 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// WorkerPool.cpp
+//
+// Runs jobs in forked worker processes. Each worker writes its output to a
+// pipe that the parent drains. Workers that crash or run past the timeout
+// are killed and reported so the parent can carry on without them.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <cerrno>
+#include <cstdio>
+#include <csignal>
+#include <iostream>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "WorkerPool.h"
+
+using namespace std;
+using namespace std::chrono;
+
+/**
+ * Creates a worker pool.
+ * @param maxWorkers The number of workers that can run at once.
+ * @param timeout The number of seconds a worker can run for. 0 disables the timeout.
+ */
+WorkerPool::WorkerPool(int maxWorkers, int timeout) : maxWorkers(maxWorkers), timeout(timeout) { }
+
+/**
+ * Kills any workers that are still running.
+ */
+WorkerPool::~WorkerPool(){
+    for (auto &worker : workers){
+        kill(worker.pid, SIGKILL);
+        waitpid(worker.pid, nullptr, 0);
+        close(worker.fd);
+    }
+}
+
+/**
+ * Checks whether another worker can be started.
+ * @return Whether the pool is full.
+ */
+bool WorkerPool::isFull(){
+    return (int) workers.size() >= maxWorkers;
+}
+
+/**
+ * Checks whether any workers are running.
+ * @return Whether the pool is empty.
+ */
+bool WorkerPool::isEmpty(){
+    return workers.size() == 0;
+}
+
+/**
+ * Forks a worker that runs a job. The job writes its output to the file descriptor
+ * it is given and the worker exits once it returns.
+ * @param id The ID the result is reported under.
+ * @param job The job to run in the worker.
+ * @return Whether the worker was started.
+ */
+bool WorkerPool::spawn(int id, function<void(int)> job){
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+
+    //Flushes the streams so buffered output isn't written by both processes.
+    cout.flush();
+    cerr.flush();
+    fflush(nullptr);
+
+    pid_t pid = fork();
+    if (pid < 0){
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    //Runs the job and exits without running the parent's destructors.
+    if (pid == 0){
+        close(fds[0]);
+        for (auto &worker : workers) close(worker.fd);
+
+        job(fds[1]);
+        close(fds[1]);
+        cout.flush();
+        cerr.flush();
+        fflush(nullptr);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    Worker worker;
+    worker.id = id;
+    worker.pid = pid;
+    worker.fd = fds[0];
+    worker.deadline = steady_clock::now() + seconds(timeout);
+    workers.push_back(worker);
+    return true;
+}
+
+/**
+ * Drains the worker pipes until at least one worker is done. Workers past
+ * their deadline are killed.
+ * @return The results of the workers that are done.
+ */
+vector<WorkerPool::Result> WorkerPool::wait(){
+    vector<Result> results;
+    vector<char> buffer(READ_BLOCK_SIZE);
+
+    while (results.size() == 0 && workers.size() > 0){
+        //Waits until output arrives or the nearest deadline passes.
+        vector<pollfd> fds;
+        int waitTime = -1;
+        steady_clock::time_point now = steady_clock::now();
+        for (auto &worker : workers){
+            fds.push_back(pollfd{worker.fd, POLLIN, 0});
+            if (timeout == 0) continue;
+
+            long long left = duration_cast<milliseconds>(worker.deadline - now).count();
+            if (left < 0) left = 0;
+            if (waitTime < 0 || left < waitTime) waitTime = (int) left;
+        }
+        if (poll(fds.data(), fds.size(), waitTime) < 0 && errno != EINTR){
+            cerr << "Error: The worker pipes could not be read." << endl;
+            for (auto &worker : workers){
+                Result result = reap(worker, true);
+                result.status = FAILED;
+                results.push_back(result);
+            }
+            workers.clear();
+            break;
+        }
+
+        //Reads the output and reaps the workers that closed their pipe.
+        now = steady_clock::now();
+        vector<Worker> running;
+        for (size_t w = 0; w < workers.size(); w++){
+            Worker &worker = workers.at(w);
+            bool done = false;
+            if (fds.at(w).revents != 0){
+                ssize_t size = read(worker.fd, buffer.data(), buffer.size());
+                if (size > 0) worker.output.append(buffer.data(), (size_t) size);
+                else if (size == 0 || (errno != EINTR && errno != EAGAIN)) done = true;
+            }
+
+            if (done){
+                results.push_back(reap(worker, false));
+            } else if (timeout > 0 && now >= worker.deadline){
+                results.push_back(reap(worker, true));
+            } else {
+                running.push_back(move(worker));
+            }
+        }
+        workers = move(running);
+    }
+
+    return results;
+}
+
+/**
+ * Writes all of a string to a file descriptor.
+ * @param fd The file descriptor.
+ * @param data The data to write.
+ * @return Whether everything was written.
+ */
+bool WorkerPool::writeAll(int fd, const string &data){
+    size_t written = 0;
+    while (written < data.size()){
+        ssize_t size = write(fd, data.data() + written, data.size() - written);
+        if (size < 0 && errno == EINTR) continue;
+        if (size <= 0) return false;
+        written += (size_t) size;
+    }
+
+    return true;
+}
+
+/**
+ * Waits for a worker to exit and gets its result.
+ * @param worker The worker.
+ * @param timedOut Whether the worker is being killed for running too long.
+ * @return The result of the worker.
+ */
+WorkerPool::Result WorkerPool::reap(Worker &worker, bool timedOut){
+    if (timedOut) kill(worker.pid, SIGKILL);
+
+    int status = 0;
+    while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR);
+    close(worker.fd);
+
+    Result result;
+    result.id = worker.id;
+    result.signal = 0;
+    result.output = move(worker.output);
+    if (timedOut){
+        result.status = TIMED_OUT;
+    } else if (WIFSIGNALED(status)){
+        result.status = CRASHED;
+        result.signal = WTERMSIG(status);
+    } else if (WIFEXITED(status) && WEXITSTATUS(status) == 0){
+        result.status = FINISHED;
+    } else {
+        result.status = FAILED;
+    }
+
+    return result;
+}
@@ -0,0 +1,77 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// WorkerPool.h
+//
+// Runs jobs in forked worker processes. Each worker writes its output to a
+// pipe that the parent drains. Workers that crash or run past the timeout
+// are killed and reported so the parent can carry on without them.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CLANGEX_WORKERPOOL_H
+#define CLANGEX_WORKERPOOL_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <sys/types.h>
+
+class WorkerPool {
+public:
+    /** Worker Results */
+    enum Status {FINISHED, FAILED, CRASHED, TIMED_OUT};
+    typedef struct {
+        int id;
+        Status status;
+        int signal;
+        std::string output;
+    } Result;
+
+    /** Constructor/Destructor */
+    WorkerPool(int maxWorkers, int timeout);
+    ~WorkerPool();
+
+    /** Pool State */
+    bool isFull();
+    bool isEmpty();
+
+    /** Worker Operations */
+    bool spawn(int id, std::function<void(int)> job);
+    std::vector<Result> wait();
+
+    /** Output Helper */
+    static bool writeAll(int fd, const std::string &data);
+
+private:
+    typedef struct {
+        int id;
+        pid_t pid;
+        int fd;
+        std::string output;
+        std::chrono::steady_clock::time_point deadline;
+    } Worker;
+
+    const int READ_BLOCK_SIZE = 65536;
+
+    int maxWorkers;
+    int timeout;
+    std::vector<Worker> workers;
+
+    /** Helper Methods */
+    Result reap(Worker &worker, bool timedOut);
+};
+
+
+#endif //CLANGEX_WORKERPOOL_H
@@ -246,6 +246,30 @@ void generateCommandSystem(map<string, ClangExHandler>* helpMap, map<string, str
             ("help,h", "Print help message for generate.")
             ("blob,b", "Runs ClangEx in blob mode.")
             ("low,l", "Enables low-memory mode.")
+            ("jobs,j", po::value<int>(), "The number of parse workers to use in low-memory or isolated mode.")
+            ("isolate", "Parses each file in a separate worker process. Files whose worker crashes are skipped.")
+            ("timeout", po::value<int>(), "The number of seconds an isolated worker can run before its file is "
+                    "skipped. 0 disables the timeout. Defaults to 0.")
+            ("visitor,v", "Uses the single-pass visitor engine in blob mode.")
+            ("include-path", po::value<std::vector<std::string>>(), "Only extracts declarations from files matching this glob.")
+            ("exclude-path", po::value<std::vector<std::string>>(), "Skips declarations from files matching this glob.")
+            ("system-headers", po::value<std::string>(), "Whether system headers are pruned or traversed. Traversed "
+                    "system headers are extracted like any other file. Defaults to prune.")
+            ("header-cache", "Extracts each header only once per run. Headers are extracted again when the "
+                    "macros they use differ. Not used for ASTs loaded from the AST cache.")
+            ("pch", "Precompiles the system includes shared by all files and parses against them.")
+            ("decls-only", "Skips function bodies and only extracts declarations.")
+            ("ast-cache", po::value<std::string>(), "Loads and stores serialized ASTs in this directory.")
+            ("snapshot", po::value<std::string>(), "Serves the source tree and include directories from this snapshot "
+                    "file. The snapshot is built if it doesn't exist and ignored if the source files changed. Delete "
+                    "it to build it again.")
+            ("prefetch", po::value<int>(), "The number of upcoming files to read ahead while parsing. 0 disables "
+                    "prefetching. Defaults to 4.")
+            ("traversal", po::value<std::string>(), "How template instantiations and implicit code are traversed. "
+                    "Either spelled, collapsed or full. Defaults to full.")
+            ("profile,p", po::value<std::vector<std::string>>(), "An output profile as MODE[:FEATURES]. MODE is blob or "
+                    "partial and FEATURES is a comma-separated list of features to disable. Each profile is written "
+                    "as its own model from a single parse.")
             ("initial,i", po::value<std::string>(), "An initial TA file to load in to merge.");
     ss.str(string());
     ss << *helpMap->at(GEN_ARG).desc;
@@ -584,6 +608,7 @@ void processGenerate(string line, po::options_description desc){
     bool blobMode = false;
     string mergeFile = "";
     bool lowMemory = false;
+    ClangDriver::GenerateSettings settings;
     po::variables_map vm;
     try {
         po::store(po::parse_command_line(argc, (const char *const *) argv, desc), vm);
@@ -605,6 +630,114 @@ void processGenerate(string line, po::options_description desc){
         if (vm.count("low")){
             lowMemory = true;
         }
+        if (vm.count("profile")){
+            if (!mergeFile.empty()){
+                cerr << "Error: Output profiles can't be merged with an initial TA file." << endl;
+                for (int i = 0; i < argc; i++) delete[] argv[i];
+                return;
+            }
+            for (string spec : vm["profile"].as<std::vector<std::string>>()){
+                if (!driver.addProfile(spec, &settings)){
+                    cerr << "Error: The output profile " << spec << " is invalid." << endl;
+                    for (int i = 0; i < argc; i++) delete[] argv[i];
+                    return;
+                }
+            }
+        }
+        if (vm.count("visitor")){
+            if (!blobMode && settings.profiles.size() == 0){
+                cerr << "Error: The visitor engine can only be used in blob mode." << endl;
+                for (int i = 0; i < argc; i++) delete[] argv[i];
+                return;
+            }
+            settings.visitorMode = true;
+        }
+        if (vm.count("include-path")){
+            settings.includeGlobs = vm["include-path"].as<std::vector<std::string>>();
+        }
+        if (vm.count("exclude-path")){
+            settings.excludeGlobs = vm["exclude-path"].as<std::vector<std::string>>();
+        }
+        if (vm.count("system-headers")){
+            string policy = vm["system-headers"].as<std::string>();
+            if (policy.compare("prune") != 0 && policy.compare("traverse") != 0){
+                cerr << "Error: The system header policy must be either prune or traverse." << endl;
+                for (int i = 0; i < argc; i++) delete[] argv[i];
+                return;
+            }
+            settings.pruneSystemHeaders = policy.compare("prune") == 0;
+        }
+        if (vm.count("snapshot")){
+            settings.snapshotFile = vm["snapshot"].as<std::string>();
+        }
+        if (vm.count("prefetch")){
+            settings.prefetchDepth = vm["prefetch"].as<int>();
+            if (settings.prefetchDepth < 0){
+                cerr << "Error: The prefetch depth can't be negative." << endl;
+                for (int i = 0; i < argc; i++) delete[] argv[i];
+                return;
+            }
+        }
+        if (vm.count("traversal")){
+            string policy = vm["traversal"].as<std::string>();
+            if (policy.compare("spelled") == 0){
+                settings.traversal = ClangDriver::SPELLED;
+            } else if (policy.compare("collapsed") == 0){
+                settings.traversal = ClangDriver::COLLAPSED;
+            } else if (policy.compare("full") == 0){
+                settings.traversal = ClangDriver::FULL;
+            } else {
+                cerr << "Error: The traversal policy must be either spelled, collapsed or full." << endl;
+                for (int i = 0; i < argc; i++) delete[] argv[i];
+                return;
+            }
+        }
+        if (vm.count("header-cache")){
+            settings.headerCache = true;
+        }
+        if (vm.count("decls-only")){
+            settings.declsOnly = true;
+        }
+        if (vm.count("pch")){
+            settings.precompiledPreamble = true;
+        }
+        if (vm.count("ast-cache")){
+            if (settings.precompiledPreamble){
+                cerr << "Error: The AST cache can't be used with a precompiled preamble." << endl;
+                for (int i = 0; i < argc; i++) delete[] argv[i];
+                return;
+            }
+            settings.astCacheDir = vm["ast-cache"].as<std::string>();
+        }
+        if (vm.count("isolate")){
+            settings.isolate = true;
+        }
+        if (vm.count("timeout")){
+            if (!settings.isolate){
+                cerr << "Error: A timeout can only be used with isolated workers." << endl;
+                for (int i = 0; i < argc; i++) delete[] argv[i];
+                return;
+            }
+            settings.timeout = vm["timeout"].as<int>();
+            if (settings.timeout < 0){
+                cerr << "Error: The timeout can't be negative." << endl;
+                for (int i = 0; i < argc; i++) delete[] argv[i];
+                return;
+            }
+        }
+        if (vm.count("jobs")){
+            settings.numJobs = vm["jobs"].as<int>();
+            if (settings.numJobs < 1){
+                cerr << "Error: The number of jobs must be at least 1." << endl;
+                for (int i = 0; i < argc; i++) delete[] argv[i];
+                return;
+            }
+            if (settings.numJobs > 1 && !lowMemory && !settings.isolate){
+                cerr << "Error: Multiple jobs can only be used in low-memory or isolated mode." << endl;
+                for (int i = 0; i < argc; i++) delete[] argv[i];
+                return;
+            }
+        }
     } catch(po::error& e) {
         cerr << "Error: " << e.what() << endl;
         cerr << desc;
@@ -622,7 +755,7 @@ void processGenerate(string line, po::options_description desc){
 
     //Next, tells ClangEx to generate them.
     cout << "Processing " << numFiles << " file(s)..." << endl << "This may take some time!" << endl << endl;
-    bool success = driver.processAllFiles(blobMode, mergeFile, lowMemory);
+    bool success = driver.processAllFiles(blobMode, mergeFile, lowMemory, settings);
 
     //Checks the success of the operation.
     if (success) {
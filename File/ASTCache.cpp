@@ -0,0 +1,139 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ASTCache.cpp
+//
+// Stores the serialized AST of each translation unit in a cache directory.
+// ASTs are keyed on the file contents and compile arguments so later runs
+// can load them instead of parsing the file again.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fstream>
+#include <sstream>
+#include "clang/Frontend/CompilerInstance.h"
+#include "ASTCache.h"
+#include "../Walker/ASTWalker.h"
+
+using namespace std;
+using namespace clang;
+using namespace clang::tooling;
+using namespace boost::filesystem;
+
+/**
+ * Creates the AST cache. The cache directory is created if it doesn't exist.
+ * @param cacheDir The directory the ASTs are stored in.
+ */
+ASTCache::ASTCache(path cacheDir) : cacheDir(cacheDir), numHits(0), numMisses(0),
+                                    containerOps(make_shared<PCHContainerOperations>()) {
+    boost::system::error_code ec;
+    create_directories(cacheDir, ec);
+    valid = !ec && is_directory(cacheDir);
+}
+
+/**
+ * Checks whether the cache directory can be used.
+ * @return Whether the cache is valid.
+ */
+bool ASTCache::isValid(){
+    return valid;
+}
+
+/**
+ * Generates the key for a translation unit. Covers the contents of the file
+ * and every argument it is compiled with.
+ * @param fileName The source file.
+ * @param command The compile command for the file.
+ * @param extraArgs Arguments that are added to the command when parsing.
+ * @return The cache key, or an empty string if the file can't be read.
+ */
+string ASTCache::generateKey(string fileName, const CompileCommand &command, vector<string> extraArgs){
+    ifstream input(fileName, ios::binary);
+    if (!input.is_open()) return string();
+
+    stringstream contents;
+    contents << input.rdbuf();
+
+    //Builds up the key from the contents and the arguments.
+    string key = ASTWalker::generateMD5(contents.str()) + "\n" + command.Directory + "\n";
+    for (string arg : command.CommandLine) key += arg + "\n";
+    for (string arg : extraArgs) key += arg + "\n";
+
+    return ASTWalker::generateMD5(key);
+}
+
+/**
+ * Loads a translation unit from the cache. Stale ASTs whose headers have
+ * changed fail validation and are removed.
+ * @param key The cache key.
+ * @return The translation unit, or null on a miss.
+ */
+unique_ptr<ASTUnit> ASTCache::load(string key){
+    string cacheFile = getCacheFile(key);
+    if (!valid || key.empty() || !exists(cacheFile)){
+        numMisses++;
+        return nullptr;
+    }
+
+    IntrusiveRefCntPtr<DiagnosticsEngine> diags =
+            CompilerInstance::createDiagnostics(new DiagnosticOptions(), new IgnoringDiagConsumer());
+    unique_ptr<ASTUnit> unit = ASTUnit::LoadFromASTFile(cacheFile, containerOps->getRawReader(), diags,
+                                                        FileSystemOptions());
+    if (unit == nullptr){
+        boost::system::error_code ec;
+        boost::filesystem::remove(cacheFile, ec);
+        numMisses++;
+        return nullptr;
+    }
+
+    numHits++;
+    return unit;
+}
+
+/**
+ * Saves a translation unit to the cache.
+ * @param key The cache key.
+ * @param unit The translation unit.
+ * @return Whether the unit was saved.
+ */
+bool ASTCache::save(string key, ASTUnit *unit){
+    if (!valid || key.empty() || unit == nullptr) return false;
+
+    //Save reports true on failure.
+    return !unit->Save(getCacheFile(key));
+}
+
+/**
+ * Gets the number of translation units loaded from the cache.
+ * @return The number of hits.
+ */
+int ASTCache::getNumHits(){
+    return numHits;
+}
+
+/**
+ * Gets the number of translation units that had to be parsed.
+ * @return The number of misses.
+ */
+int ASTCache::getNumMisses(){
+    return numMisses;
+}
+
+/**
+ * Gets the file an AST is stored in.
+ * @param key The cache key.
+ * @return The path of the file.
+ */
+string ASTCache::getCacheFile(string key){
+    return (cacheDir / (key + AST_EXT)).string();
+}
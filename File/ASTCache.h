@@ -0,0 +1,64 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ASTCache.h
+//
+// Stores the serialized AST of each translation unit in a cache directory.
+// ASTs are keyed on the file contents and compile arguments so later runs
+// can load them instead of parsing the file again.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CLANGEX_ASTCACHE_H
+#define CLANGEX_ASTCACHE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <boost/filesystem.hpp>
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/PCHContainerOperations.h"
+#include "clang/Tooling/CompilationDatabase.h"
+
+class ASTCache {
+public:
+    /** Constructor */
+    ASTCache(boost::filesystem::path cacheDir);
+
+    /** Cache Operations */
+    bool isValid();
+    std::string generateKey(std::string fileName, const clang::tooling::CompileCommand &command,
+                            std::vector<std::string> extraArgs);
+    std::unique_ptr<clang::ASTUnit> load(std::string key);
+    bool save(std::string key, clang::ASTUnit *unit);
+
+    /** Cache Statistics */
+    int getNumHits();
+    int getNumMisses();
+
+private:
+    const std::string AST_EXT = ".ast";
+
+    boost::filesystem::path cacheDir;
+    bool valid;
+    std::atomic<int> numHits;
+    std::atomic<int> numMisses;
+    std::shared_ptr<clang::PCHContainerOperations> containerOps;
+
+    /** Helper Methods */
+    std::string getCacheFile(std::string key);
+};
+
+
+#endif //CLANGEX_ASTCACHE_H
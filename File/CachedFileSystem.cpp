@@ -0,0 +1,257 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CachedFileSystem.cpp
+//
+// Virtual file system that caches stats and file contents so they can be
+// shared by every translation unit in a run. Headers are only stat'ed and
+// read from disk once. File contents are evicted least recently used first
+// once the cache grows past its size limit.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "CachedFileSystem.h"
+
+using namespace std;
+using namespace clang;
+using namespace llvm;
+
+/**
+ * Creates the cached file system.
+ * @param base The file system being cached.
+ * @param maxContentSize The most bytes of file contents to keep cached.
+ */
+CachedFileSystem::CachedFileSystem(IntrusiveRefCntPtr<vfs::FileSystem> base, size_t maxContentSize) :
+        base(base), maxContentSize(maxContentSize), numStatHits(0), numContentHits(0) {
+    ErrorOr<string> dir = base->getCurrentWorkingDirectory();
+    if (dir) workingDir = *dir;
+}
+
+/**
+ * Gets the status of a file. Missing files are cached as well since header
+ * search probes the same missing paths in every translation unit.
+ * @param path The path to the file.
+ * @return The status of the file.
+ */
+ErrorOr<vfs::Status> CachedFileSystem::status(const Twine &path){
+    string key = getKey(path);
+    {
+        lock_guard<mutex> lock(cacheLock);
+        auto cached = stats.find(key);
+        if (cached != stats.end()){
+            numStatHits++;
+            if (cached->second.error) return cached->second.error;
+            return vfs::Status::copyWithNewName(cached->second.status, path.str());
+        }
+    }
+
+    //Stats the file outside the lock.
+    ErrorOr<vfs::Status> result = base->status(key);
+    StatEntry entry;
+    if (result) entry.status = *result;
+    else entry.error = result.getError();
+
+    lock_guard<mutex> lock(cacheLock);
+    if (stats.size() >= (size_t) MAX_STATS) stats.clear();
+    stats[key] = entry;
+
+    if (entry.error) return entry.error;
+    return vfs::Status::copyWithNewName(entry.status, path.str());
+}
+
+/**
+ * Opens a file for reading. The file isn't read until its buffer is needed.
+ * @param path The path to the file.
+ * @return The opened file.
+ */
+ErrorOr<unique_ptr<vfs::File>> CachedFileSystem::openFileForRead(const Twine &path){
+    ErrorOr<vfs::Status> fileStatus = status(path);
+    if (!fileStatus) return fileStatus.getError();
+    if (fileStatus->isDirectory()) return base->openFileForRead(path);
+
+    return unique_ptr<vfs::File>(new CachedFile(this, getKey(path), *fileStatus));
+}
+
+/**
+ * Lists a directory. Directory listings aren't cached.
+ * @param dir The directory to list.
+ * @param ec The error code.
+ * @return The directory iterator.
+ */
+vfs::directory_iterator CachedFileSystem::dir_begin(const Twine &dir, error_code &ec){
+    return base->dir_begin(dir, ec);
+}
+
+/**
+ * Sets the working directory used to resolve relative paths.
+ * @param path The new working directory.
+ * @return The error code.
+ */
+error_code CachedFileSystem::setCurrentWorkingDirectory(const Twine &path){
+    error_code ec = base->setCurrentWorkingDirectory(path);
+    if (ec) return ec;
+
+    ErrorOr<string> dir = base->getCurrentWorkingDirectory();
+    lock_guard<mutex> lock(cacheLock);
+    workingDir = (dir) ? *dir : path.str();
+    return ec;
+}
+
+/**
+ * Gets the working directory used to resolve relative paths.
+ * @return The working directory.
+ */
+ErrorOr<string> CachedFileSystem::getCurrentWorkingDirectory() const {
+    lock_guard<mutex> lock(cacheLock);
+    return workingDir;
+}
+
+/**
+ * Gets the contents of a file. Contents are shared with every buffer that was
+ * handed out, so evicting them never invalidates a buffer that is in use.
+ * @param path The absolute path to the file.
+ * @return The contents of the file.
+ */
+ErrorOr<shared_ptr<const string>> CachedFileSystem::getContents(string path){
+    {
+        lock_guard<mutex> lock(cacheLock);
+        auto cached = contents.find(path);
+        if (cached != contents.end()){
+            numContentHits++;
+            recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, cached->second.position);
+            return cached->second.contents;
+        }
+    }
+
+    //Reads the file outside the lock.
+    ErrorOr<unique_ptr<MemoryBuffer>> buffer = base->getBufferForFile(path);
+    if (!buffer) return buffer.getError();
+    shared_ptr<const string> fileContents = make_shared<const string>((*buffer)->getBuffer().str());
+
+    lock_guard<mutex> lock(cacheLock);
+    if (contents.find(path) != contents.end()) return fileContents;
+
+    //Adds the contents and evicts the least recently used files.
+    recentlyUsed.push_front(path);
+    contents[path] = ContentEntry{fileContents, recentlyUsed.begin()};
+    contentSize += fileContents->size();
+    while (contentSize > maxContentSize && recentlyUsed.size() > 1){
+        auto evicted = contents.find(recentlyUsed.back());
+        contentSize -= evicted->second.contents->size();
+        contents.erase(evicted);
+        recentlyUsed.pop_back();
+    }
+
+    return fileContents;
+}
+
+/**
+ * Gets the number of stats served from the cache.
+ * @return The number of stat hits.
+ */
+int CachedFileSystem::getNumStatHits(){
+    return numStatHits;
+}
+
+/**
+ * Gets the number of file reads served from the cache.
+ * @return The number of content hits.
+ */
+int CachedFileSystem::getNumContentHits(){
+    return numContentHits;
+}
+
+/**
+ * Generates the cache key for a path. Relative paths are made absolute.
+ * @param path The path.
+ * @return The cache key.
+ */
+string CachedFileSystem::getKey(const Twine &path){
+    SmallString<256> key;
+    path.toVector(key);
+    {
+        lock_guard<mutex> lock(cacheLock);
+        sys::fs::make_absolute(workingDir, key);
+    }
+    sys::path::remove_dots(key);
+
+    return key.str();
+}
+
+/**
+ * Creates a cached file.
+ * @param fileSystem The file system the file belongs to.
+ * @param key The absolute path to the file.
+ * @param status The status of the file.
+ */
+CachedFile::CachedFile(CachedFileSystem* fileSystem, string key, vfs::Status status) :
+        fileSystem(fileSystem), key(key), fileStatus(status) { }
+
+/**
+ * Gets the status of the file.
+ * @return The status of the file.
+ */
+ErrorOr<vfs::Status> CachedFile::status(){
+    return fileStatus;
+}
+
+/**
+ * Gets the contents of the file.
+ * @param name The name of the buffer.
+ * @param fileSize The expected size of the file.
+ * @param requiresNullTerminator Whether the buffer must end in a null. Cached buffers always do.
+ * @param isVolatile Whether the file may change while it is read.
+ * @return The buffer.
+ */
+ErrorOr<unique_ptr<MemoryBuffer>> CachedFile::getBuffer(const Twine &name, int64_t fileSize,
+                                                        bool requiresNullTerminator, bool isVolatile){
+    ErrorOr<shared_ptr<const string>> contents = fileSystem->getContents(key);
+    if (!contents) return contents.getError();
+
+    return unique_ptr<MemoryBuffer>(new SharedBuffer(*contents, name.str()));
+}
+
+/**
+ * Closes the file. Nothing is held open.
+ * @return The error code.
+ */
+error_code CachedFile::close(){
+    return error_code();
+}
+
+/**
+ * Creates a buffer that shares cached file contents.
+ * @param contents The contents of the file.
+ * @param name The name of the buffer.
+ */
+SharedBuffer::SharedBuffer(shared_ptr<const string> contents, string name) : contents(contents), name(name) {
+    init(this->contents->data(), this->contents->data() + this->contents->size(), true);
+}
+
+/**
+ * Gets the name of the buffer.
+ * @return The buffer name.
+ */
+StringRef SharedBuffer::getBufferIdentifier() const {
+    return name;
+}
+
+/**
+ * Gets the kind of memory the buffer uses.
+ * @return The buffer kind.
+ */
+MemoryBuffer::BufferKind SharedBuffer::getBufferKind() const {
+    return MemoryBuffer_Malloc;
+}
@@ -0,0 +1,117 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CachedFileSystem.h
+//
+// Virtual file system that caches stats and file contents so they can be
+// shared by every translation unit in a run. Headers are only stat'ed and
+// read from disk once. File contents are evicted least recently used first
+// once the cache grows past its size limit.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CLANGEX_CACHEDFILESYSTEM_H
+#define CLANGEX_CACHEDFILESYSTEM_H
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include "clang/Basic/VirtualFileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+class CachedFileSystem : public clang::vfs::FileSystem {
+public:
+    /** Constructor */
+    CachedFileSystem(llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> base, size_t maxContentSize);
+
+    /** File System Operations */
+    llvm::ErrorOr<clang::vfs::Status> status(const llvm::Twine &path) override;
+    llvm::ErrorOr<std::unique_ptr<clang::vfs::File>> openFileForRead(const llvm::Twine &path) override;
+    clang::vfs::directory_iterator dir_begin(const llvm::Twine &dir, std::error_code &ec) override;
+    std::error_code setCurrentWorkingDirectory(const llvm::Twine &path) override;
+    llvm::ErrorOr<std::string> getCurrentWorkingDirectory() const override;
+
+    /** Contents */
+    llvm::ErrorOr<std::shared_ptr<const std::string>> getContents(std::string path);
+
+    /** Cache Statistics */
+    int getNumStatHits();
+    int getNumContentHits();
+
+private:
+    const int MAX_STATS = 262144;
+
+    /** Cache Entries */
+    typedef struct {
+        std::error_code error;
+        clang::vfs::Status status;
+    } StatEntry;
+    typedef struct {
+        std::shared_ptr<const std::string> contents;
+        std::list<std::string>::iterator position;
+    } ContentEntry;
+
+    llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> base;
+    std::string workingDir;
+
+    /** Caches */
+    mutable std::mutex cacheLock;
+    std::unordered_map<std::string, StatEntry> stats;
+    std::unordered_map<std::string, ContentEntry> contents;
+    std::list<std::string> recentlyUsed;
+    size_t contentSize = 0;
+    size_t maxContentSize;
+    std::atomic<int> numStatHits;
+    std::atomic<int> numContentHits;
+
+    /** Helper Methods */
+    std::string getKey(const llvm::Twine &path);
+};
+
+class CachedFile : public clang::vfs::File {
+public:
+    /** Constructor */
+    CachedFile(CachedFileSystem* fileSystem, std::string key, clang::vfs::Status status);
+
+    /** File Operations */
+    llvm::ErrorOr<clang::vfs::Status> status() override;
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> getBuffer(const llvm::Twine &name, int64_t fileSize,
+                                                                 bool requiresNullTerminator,
+                                                                 bool isVolatile) override;
+    std::error_code close() override;
+
+private:
+    CachedFileSystem* fileSystem;
+    std::string key;
+    clang::vfs::Status fileStatus;
+};
+
+class SharedBuffer : public llvm::MemoryBuffer {
+public:
+    /** Constructor */
+    SharedBuffer(std::shared_ptr<const std::string> contents, std::string name);
+
+    /** Buffer Information */
+    llvm::StringRef getBufferIdentifier() const override;
+    BufferKind getBufferKind() const override;
+
+private:
+    std::shared_ptr<const std::string> contents;
+    std::string name;
+};
+
+
+#endif //CLANGEX_CACHEDFILESYSTEM_H
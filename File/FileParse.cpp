@@ -24,6 +24,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <thread>
+#include <atomic>
+#include <algorithm>
 #include <boost/filesystem.hpp>
 #include "FileParse.h"
 #include "../Walker/ASTWalker.h"
@@ -43,115 +46,149 @@ FileParse::~FileParse() {}
 /**
  * Adds a singular file to the list.
  * @param path The path to add.
+ * @return Whether the path is new.
  */
-void FileParse::addPath(string path) {
+bool FileParse::addPath(string path) {
     //Check if path already exists.
-    for (int i = 0; i < paths.size(); i++) {
-        if (paths.at(i).compare(path) == 0) return;
-    }
+    if (!pathSet.insert(path).second) return false;
 
-    //Add it to the vector if it doesn't.
+    //Add it to the list and the trie if it doesn't.
     paths.push_back(path);
+    insertPath(path);
+    return true;
 }
 
 /**
  * Creates nodes and edges for every single path that was added to the list.
+ * Each directory in the trie is only created once. The subtrees below the first
+ * directory that branches are built in parallel.
  * @param nodes The created nodes. (Should be empty on invocation).
  * @param edges The created edges. (Should be empty on invocation).
+ * @param numThreads The number of threads to use. Callers that already run in parallel pass fewer.
  */
-void FileParse::processPaths(vector<ClangNode*>& nodes, vector<ClangEdge*>& edges) {
-    //Iterate through all the paths.
-    for (int i = 0; i < paths.size(); i++){
-        processPath(paths.at(i), nodes, edges);
+void FileParse::processPaths(vector<ClangNode*>& nodes, vector<ClangEdge*>& edges, int numThreads) {
+    if (trie.empty()) return;
+
+    //Creates the shared directories down to the first branch.
+    vector<ClangNode*> created(trie.size(), nullptr);
+    int split = 0;
+    while (trie.at(split).children.size() == 1){
+        split = trie.at(split).children.at(0);
+        processNode(split, created, nodes, edges);
+    }
+
+    //Workers pull subtrees off a shared counter.
+    const vector<int>& subtrees = trie.at(split).children;
+    vector<vector<ClangNode*>> subNodes(subtrees.size());
+    vector<vector<ClangEdge*>> subEdges(subtrees.size());
+    atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next++; i < (int) subtrees.size(); i = next++){
+            processSubtree(subtrees.at(i), created, subNodes.at(i), subEdges.at(i));
+        }
+    };
+
+    int numWorkers = (int) min<size_t>((size_t) max(numThreads, 1), subtrees.size());
+    vector<thread> workers;
+    for (int i = 1; i < numWorkers; i++) workers.push_back(thread(worker));
+    worker();
+    for (auto& cur : workers) cur.join();
+
+    //Collects the subtrees in order.
+    for (int i = 0; i < subtrees.size(); i++){
+        nodes.insert(nodes.end(), subNodes.at(i).begin(), subNodes.at(i).end());
+        edges.insert(edges.end(), subEdges.at(i).begin(), subEdges.at(i).end());
     }
 }
 
 /**
- * Processes an individual path in the path list. Creates the associated nodes
- * and edges.
- * @param path The path to create.
- * @param curPath The set of created nodes.
- * @param curContains The set of created edges.
+ * Gets every path that was added to the list.
+ * @return The list of paths.
  */
-void FileParse::processPath(string path, vector<ClangNode*>& curPath, vector<ClangEdge*>& curContains) {
+vector<string> FileParse::getPaths() {
+    return paths;
+}
+
+/**
+ * Inserts a path into the directory trie.
+ * @param path The path to insert.
+ */
+void FileParse::insertPath(string path) {
+    if (trie.empty()) trie.push_back(PathNode());
+
     //Start by iterating at each path element.
-    vector<string> pathComponents = vector<string>();
-    vector<string> pathLabels = vector<string>();
+    boost::filesystem::path fullPath = boost::filesystem::path(path);
+    long numComponents = distance(fullPath.begin(), fullPath.end());
+    string component;
+    int cur = 0;
     int i = 0;
-    for (auto& curr : boost::filesystem::path(path)){
+    for (auto& curr : fullPath){
+        string label = curr.string();
         if (i == 0) {
-            pathComponents.push_back(curr.string());
+            component = label;
         } else {
-            string craft = (i == 1) ? "" : "/";
-            pathComponents.push_back(pathComponents.at(i - 1) + craft + curr.string());
+            component += ((i == 1) ? "" : "/") + label;
         }
 
-        pathLabels.push_back(curr.string());
-        i++;
-    }
-
-    //Next, we iterate until we hit the end.
-    ClangNode* prevNode = nullptr;
-    for (int i = 0; i < pathComponents.size(); i++){
-        ClangNode* currentNode;
-
-        //Check if a path component exists.
-        int existsIndex = doesNodeExist(ASTWalker::generateMD5(pathComponents.at(i)), curPath);
-        if (existsIndex == -1){
-            //Determines the type of node.
-            ClangNode::NodeType type;
-            if (i + 1 == pathComponents.size()){
-                type = ClangNode::FILE;
-            } else {
-                type = ClangNode::SUBSYSTEM;
-            }
-
-            //Creates the node.
-            string current = ASTWalker::generateMD5(pathComponents.at(i));
-            currentNode = new ClangNode(current, pathLabels.at(i), type);
-            curPath.push_back(currentNode);
+        //Check if the path component exists.
+        auto existing = trie.at(cur).childIndex.find(label);
+        if (existing == trie.at(cur).childIndex.end()){
+            PathNode node;
+            node.component = component;
+            node.label = label;
+            node.file = (i + 1 == numComponents);
+            node.parent = cur;
+            trie.push_back(node);
+
+            int next = (int) trie.size() - 1;
+            trie.at(cur).childIndex[label] = next;
+            trie.at(cur).children.push_back(next);
+            cur = next;
         } else {
-            currentNode = curPath.at(existsIndex);
-        }
-
-        //Next, deals with contains.
-        if (prevNode != nullptr && !doesEdgeExist(prevNode, currentNode, curContains)){
-            //Adds a new link.
-            curContains.push_back(new ClangEdge(prevNode, currentNode, ClangEdge::CONTAINS));
+            cur = existing->second;
         }
 
-        prevNode = currentNode;
+        i++;
     }
 }
 
 /**
- * Checks if a node already exists in the associated list.
- * @param ID The ID to check for.
- * @param nodes The list of nodes to check in.
- * @return Index of where the node is in the list.
+ * Creates the nodes and edges for a subtree of the trie.
+ * @param root The root of the subtree.
+ * @param created The nodes created for each trie entry.
+ * @param nodes The created nodes.
+ * @param edges The created edges.
  */
-int FileParse::doesNodeExist(string ID, const vector<ClangNode*>& nodes){
-    //Iterates through and checks.
-    for (int i = 0; i < nodes.size(); i++){
-        ClangNode* curNode = nodes.at(i);
-        if (curNode->getID().compare(ID) == 0) return i;
+void FileParse::processSubtree(int root, vector<ClangNode*>& created, vector<ClangNode*>& nodes,
+                               vector<ClangEdge*>& edges) {
+    //Walks the subtree so parents are created before their children.
+    vector<int> toVisit;
+    toVisit.push_back(root);
+    while (!toVisit.empty()){
+        int cur = toVisit.back();
+        toVisit.pop_back();
+
+        processNode(cur, created, nodes, edges);
+        toVisit.insert(toVisit.end(), trie.at(cur).children.rbegin(), trie.at(cur).children.rend());
     }
-
-    return -1;
 }
 
 /**
- * Checks if an edge already exists in the associated list.
- * @param src The source ID.
- * @param dst The destination ID.
- * @param edges The edge list to check in.
- * @return The index of where the node is in the list.
+ * Creates the node for a trie entry and the edge to its parent.
+ * @param cur The trie entry.
+ * @param created The nodes created for each trie entry.
+ * @param nodes The created nodes.
+ * @param edges The created edges.
  */
-bool FileParse::doesEdgeExist(ClangNode* src, ClangNode* dst, const vector<ClangEdge*>& edges){
-    //Iterates through and checks.
-    for (auto curEdge : edges){
-        if (curEdge->getSrc() == src && curEdge->getDst() == dst) return true;
-    }
+void FileParse::processNode(int cur, vector<ClangNode*>& created, vector<ClangNode*>& nodes,
+                            vector<ClangEdge*>& edges) {
+    const PathNode& node = trie.at(cur);
+
+    //Creates the node.
+    ClangNode::NodeType type = (node.file) ? ClangNode::FILE : ClangNode::SUBSYSTEM;
+    created[cur] = new ClangNode(ASTWalker::generateMD5(node.component), node.label, type);
+    nodes.push_back(created[cur]);
 
-    return false;
+    //Next, deals with contains.
+    if (node.parent != 0) edges.push_back(new ClangEdge(created[node.parent], created[cur], ClangEdge::CONTAINS));
 }
@@ -29,6 +29,8 @@
 
 #include <string>
 #include <vector>
+#include <unordered_set>
+#include <unordered_map>
 #include "../Graph/ClangNode.h"
 #include "../Graph/ClangEdge.h"
 
@@ -39,20 +41,32 @@ public:
     ~FileParse();
 
     /** Path Creation Operations */
-    void addPath(std::string path);
-    void processPaths(std::vector<ClangNode*>& nodes, std::vector<ClangEdge*>& edges);
+    bool addPath(std::string path);
+    void processPaths(std::vector<ClangNode*>& nodes, std::vector<ClangEdge*>& edges, int numThreads = 1);
+    std::vector<std::string> getPaths();
 
 private:
+    /** Directory Trie Node */
+    typedef struct {
+        std::string component;
+        std::string label;
+        bool file = false;
+        int parent = 0;
+        std::vector<int> children;
+        std::unordered_map<std::string, int> childIndex;
+    } PathNode;
+
     /** Member Variables */
     std::vector<std::string> paths;
+    std::unordered_set<std::string> pathSet;
+    std::vector<PathNode> trie;
 
     /** Helper Methods */
-    void processPath(std::string path, std::vector<ClangNode*>& curPath,
-                     std::vector<ClangEdge*>& curContains);
-
-    /** Node Search Operations */
-    int doesNodeExist(std::string ID, const std::vector<ClangNode*>& nodes);
-    bool doesEdgeExist(ClangNode* src, ClangNode* dst, const std::vector<ClangEdge*>& edges);
+    void insertPath(std::string path);
+    void processSubtree(int root, std::vector<ClangNode*>& created, std::vector<ClangNode*>& nodes,
+                        std::vector<ClangEdge*>& edges);
+    void processNode(int cur, std::vector<ClangNode*>& created, std::vector<ClangNode*>& nodes,
+                     std::vector<ClangEdge*>& edges);
 };
 
 
@@ -0,0 +1,148 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// FilePrefetcher.cpp
+//
+// Warms the page cache for the translation units that are coming up next.
+// When a unit starts parsing, the next few source files are read on a
+// background thread and the headers they include by quotes are advised
+// to the kernel, so their I/O overlaps with the current unit.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <fstream>
+#include <boost/algorithm/string.hpp>
+#include "FilePrefetcher.h"
+
+using namespace std;
+using namespace boost::filesystem;
+
+/**
+ * Creates the prefetcher and starts its background thread.
+ * @param files The files in the order they are processed.
+ * @param depth How many files ahead to prefetch.
+ */
+FilePrefetcher::FilePrefetcher(vector<path> files, int depth) : depth(depth) {
+    for (path file : files){
+        string fileName = normalize(file.string());
+        fileIndex[fileName] = (int) this->files.size();
+        this->files.push_back(fileName);
+    }
+
+    worker = thread(&FilePrefetcher::run, this);
+}
+
+/**
+ * Stops the background thread. Anything still queued is dropped.
+ */
+FilePrefetcher::~FilePrefetcher(){
+    {
+        lock_guard<mutex> lock(queueLock);
+        stopping = true;
+    }
+    queueReady.notify_all();
+    worker.join();
+}
+
+/**
+ * Notifies the prefetcher that a file started parsing. The files after it are queued.
+ * @param fileName The file that started parsing.
+ */
+void FilePrefetcher::advance(string fileName){
+    auto it = fileIndex.find(normalize(fileName));
+    if (it == fileIndex.end()) return;
+
+    {
+        lock_guard<mutex> lock(queueLock);
+        for (int i = it->second + 1; i <= it->second + depth && i < files.size(); i++){
+            if (queued.insert(files.at(i)).second) queue.push_back(files.at(i));
+        }
+    }
+    queueReady.notify_one();
+}
+
+/**
+ * Resolves a file to the key it is stored under. Clang can hand over a path
+ * relative to a different directory or through a symlink, so both sides use the
+ * canonical path. Files that can't be resolved fall back to their absolute path.
+ * @param fileName The file to resolve.
+ * @return The canonical path.
+ */
+string FilePrefetcher::normalize(string fileName){
+    boost::system::error_code ec;
+    path resolved = canonical(fileName, ec);
+    if (ec) return absolute(fileName).string();
+
+    return resolved.string();
+}
+
+/**
+ * Prefetches queued files until the prefetcher is stopped.
+ */
+void FilePrefetcher::run(){
+    while (true){
+        string next;
+        {
+            unique_lock<mutex> lock(queueLock);
+            queueReady.wait(lock, [this]{ return stopping || !queue.empty(); });
+            if (stopping) return;
+
+            next = queue.front();
+            queue.pop_front();
+        }
+
+        prefetchSource(next);
+    }
+}
+
+/**
+ * Reads a source file and advises the headers it includes by quotes.
+ * System headers are left alone since they are almost always already cached.
+ * @param fileName The source file.
+ */
+void FilePrefetcher::prefetchSource(string fileName){
+    adviseFile(fileName);
+
+    ifstream input(fileName);
+    if (!input.is_open()) return;
+    path dir = path(fileName).parent_path();
+
+    string line;
+    for (int i = 0; i < MAX_SCAN_LINES && getline(input, line); i++){
+        boost::trim(line);
+        if (line.empty() || line.at(0) != '#') continue;
+
+        string directive = boost::trim_copy(line.substr(1));
+        if (directive.compare(0, 7, "include") != 0) continue;
+        string target = boost::trim_copy(directive.substr(7));
+        if (target.size() < 2 || target.at(0) != '"') continue;
+
+        size_t end = target.find('"', 1);
+        if (end == string::npos) continue;
+        adviseFile((dir / target.substr(1, end - 1)).string());
+    }
+}
+
+/**
+ * Asks the kernel to read a file into the page cache.
+ * @param fileName The file.
+ */
+void FilePrefetcher::adviseFile(string fileName){
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}
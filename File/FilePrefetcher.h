@@ -0,0 +1,68 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// FilePrefetcher.h
+//
+// Warms the page cache for the translation units that are coming up next.
+// When a unit starts parsing, the next few source files are read on a
+// background thread and the headers they include by quotes are advised
+// to the kernel, so their I/O overlaps with the current unit.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CLANGEX_FILEPREFETCHER_H
+#define CLANGEX_FILEPREFETCHER_H
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <condition_variable>
+#include <boost/filesystem.hpp>
+
+class FilePrefetcher {
+public:
+    /** Constructor/Destructor */
+    FilePrefetcher(std::vector<boost::filesystem::path> files, int depth);
+    ~FilePrefetcher();
+
+    /** Prefetching */
+    void advance(std::string fileName);
+
+private:
+    const int MAX_SCAN_LINES = 500;
+
+    std::vector<std::string> files;
+    std::unordered_map<std::string, int> fileIndex;
+    int depth;
+
+    /** Work Queue */
+    std::mutex queueLock;
+    std::condition_variable queueReady;
+    std::deque<std::string> queue;
+    std::unordered_set<std::string> queued;
+    bool stopping = false;
+    std::thread worker;
+
+    /** Helper Methods */
+    std::string normalize(std::string fileName);
+    void run();
+    void prefetchSource(std::string fileName);
+    void adviseFile(std::string fileName);
+};
+
+
+#endif //CLANGEX_FILEPREFETCHER_H
@@ -0,0 +1,487 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SnapshotFileSystem.cpp
+//
+// Packs the source tree and include directories into a single snapshot
+// file and serves them to Clang from memory. Lookups inside the snapshot
+// never touch the original file system, which helps when the sources
+// live on a slow network file system. Files keep their original paths.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "SnapshotFileSystem.h"
+
+using namespace std;
+using namespace clang;
+using namespace llvm;
+namespace bs = boost::filesystem;
+
+const string SnapshotFileSystem::SNAPSHOT_HEADER = "CLANGEX-SNAPSHOT 1";
+const string SnapshotFileSystem::DATA_MARKER = "DATA";
+
+/**
+ * Creates the snapshot file system. Paths outside the snapshot go to the base file system.
+ * @param base The file system being overlaid.
+ */
+SnapshotFileSystem::SnapshotFileSystem(IntrusiveRefCntPtr<vfs::FileSystem> base) : base(base) {
+    ErrorOr<string> dir = base->getCurrentWorkingDirectory();
+    if (dir) workingDir = *dir;
+}
+
+/**
+ * Builds a snapshot of a set of directories. Every directory under the roots is
+ * recorded so lookups of missing files can be answered from the snapshot. Files
+ * that can't be stored, like symlinked directories, are passed to the real file system.
+ * @param snapshotFile The snapshot file to write.
+ * @param roots The directories to snapshot.
+ * @return Whether the snapshot was built.
+ */
+bool SnapshotFileSystem::build(string snapshotFile, vector<bs::path> roots){
+    vector<string> dirs;
+    vector<string> passthroughs;
+    vector<string> entries;
+    unordered_set<string> seenDirs;
+    uintmax_t totalSize = 0;
+
+    //Outer roots go first so nested roots are already covered.
+    vector<string> rootNames;
+    for (bs::path root : roots) rootNames.push_back(normalize(root.string()));
+    sort(rootNames.begin(), rootNames.end(), [](const string &a, const string &b){ return a.size() < b.size(); });
+
+    for (string root : rootNames){
+        boost::system::error_code ec;
+        if (!bs::is_directory(root, ec) || seenDirs.find(root) != seenDirs.end()) continue;
+        seenDirs.insert(root);
+        dirs.push_back(root);
+
+        for (bs::recursive_directory_iterator it(root, ec), end; it != end; it.increment(ec)){
+            if (ec) {
+                ec.clear();
+                continue;
+            }
+
+            string cur = normalize(it->path().string());
+            if (cur.find('\n') != string::npos){
+                passthroughs.push_back(normalize(it->path().parent_path().string()));
+                continue;
+            }
+
+            //Symlinked files are stored but symlinked directories are not followed.
+            bs::file_status linkStatus = bs::symlink_status(it->path(), ec);
+            bool isLink = bs::is_symlink(linkStatus);
+            if (!isLink && bs::is_directory(linkStatus)){
+                if (seenDirs.insert(cur).second) dirs.push_back(cur);
+                continue;
+            }
+            if (!bs::is_regular_file(it->path(), ec)){
+                passthroughs.push_back(cur);
+                continue;
+            }
+
+            uintmax_t size = bs::file_size(it->path(), ec);
+            if (ec || size > MAX_FILE_SIZE){
+                ec.clear();
+                passthroughs.push_back(cur);
+                continue;
+            }
+
+            totalSize += size + 1;
+            if (totalSize > MAX_SNAPSHOT_SIZE) return false;
+            entries.push_back(cur);
+        }
+    }
+
+    //Writes the file contents first since sizes may change while reading.
+    string dataFile = snapshotFile + ".data";
+    string indexFile = snapshotFile + ".tmp";
+    stringstream index;
+    ofstream data(dataFile, ios::binary);
+    if (!data.is_open()) return false;
+
+    size_t offset = 0;
+    int numFiles = 0;
+    for (string entry : entries){
+        ifstream input(entry, ios::binary);
+        if (!input.is_open()){
+            passthroughs.push_back(entry);
+            continue;
+        }
+
+        stringstream contents;
+        contents << input.rdbuf();
+        string fileContents = contents.str();
+        data.write(fileContents.c_str(), fileContents.size() + 1);
+
+        boost::system::error_code ec;
+        time_t modified = bs::last_write_time(entry, ec);
+        index << offset << " " << fileContents.size() << " " << ((ec) ? 0 : modified) << " " << entry << "\n";
+        offset += fileContents.size() + 1;
+        numFiles++;
+    }
+    data.close();
+
+    //Writes the index followed by the contents.
+    ofstream output(indexFile, ios::binary);
+    if (!output.is_open()){
+        bs::remove(dataFile);
+        return false;
+    }
+    output << SNAPSHOT_HEADER << "\n" << dirs.size() << " " << passthroughs.size() << " " << numFiles << "\n";
+    for (string dir : dirs) output << dir << "\n";
+    for (string pass : passthroughs) output << pass << "\n";
+    output << index.str() << DATA_MARKER << "\n";
+
+    ifstream dataInput(dataFile, ios::binary);
+    if (offset > 0) output << dataInput.rdbuf();
+    dataInput.close();
+    output.close();
+    bool success = !output.fail();
+
+    boost::system::error_code ec;
+    bs::remove(dataFile, ec);
+    if (success) bs::rename(indexFile, snapshotFile, ec);
+    else bs::remove(indexFile, ec);
+
+    return success && !ec;
+}
+
+/**
+ * Loads a snapshot. The snapshot is memory mapped and files are served straight from it.
+ * @param snapshotFile The snapshot file.
+ * @return Whether the snapshot was loaded.
+ */
+bool SnapshotFileSystem::load(string snapshotFile){
+    ErrorOr<unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(snapshotFile, -1, false);
+    if (!buffer) return false;
+    snapshot = move(*buffer);
+
+    StringRef contents = snapshot->getBuffer();
+    size_t pos = 0;
+    auto nextLine = [&contents, &pos]() -> StringRef {
+        size_t end = contents.find('\n', pos);
+        if (end == StringRef::npos) end = contents.size();
+        StringRef line = contents.slice(pos, end);
+        pos = end + 1;
+        return line;
+    };
+
+    //Reads the header.
+    if (nextLine() != SNAPSHOT_HEADER) return false;
+    SmallVector<StringRef, 3> counts;
+    nextLine().split(counts, ' ');
+    size_t numDirs, numPassthrough, numFiles;
+    if (counts.size() != 3 || counts[0].getAsInteger(10, numDirs) || counts[1].getAsInteger(10, numPassthrough) ||
+            counts[2].getAsInteger(10, numFiles)) return false;
+
+    //Reads the index.
+    for (size_t i = 0; i < numDirs; i++) directories[nextLine().str()] = vfs::getNextVirtualUniqueID();
+    for (size_t i = 0; i < numPassthrough; i++) passthrough.insert(nextLine().str());
+    for (size_t i = 0; i < numFiles; i++){
+        StringRef line = nextLine();
+        SmallVector<StringRef, 4> fields;
+        line.split(fields, ' ', 3);
+
+        FileEntry entry;
+        long long modified;
+        if (fields.size() != 4 || fields[0].getAsInteger(10, entry.offset) || fields[1].getAsInteger(10, entry.size) ||
+                fields[2].getAsInteger(10, modified)) return false;
+        entry.modified = (time_t) modified;
+        entry.uniqueID = vfs::getNextVirtualUniqueID();
+        files[fields[3].str()] = entry;
+    }
+    if (nextLine() != DATA_MARKER || pos > contents.size()) return false;
+
+    //Indexes the children of each directory for listings.
+    for (auto &entry : files){
+        children[sys::path::parent_path(entry.first)].push_back(sys::path::filename(entry.first));
+    }
+    for (auto &entry : directories){
+        string parent = sys::path::parent_path(entry.first);
+        if (directories.find(parent) != directories.end()) children[parent].push_back(sys::path::filename(entry.first));
+    }
+    for (auto &entry : passthrough) children[sys::path::parent_path(entry)].push_back(sys::path::filename(entry));
+
+    //Checks that every file is inside the snapshot.
+    size_t dataSize = contents.size() - pos;
+    for (auto &entry : files){
+        if (entry.second.offset + entry.second.size + 1 > dataSize) return false;
+    }
+
+    data = contents.data() + pos;
+    return true;
+}
+
+/**
+ * Checks that files still match the snapshot. Files whose size or modification time
+ * changed, or that were added after the snapshot was built, make it stale.
+ * @param paths The files to check.
+ * @return Whether the snapshot is current.
+ */
+bool SnapshotFileSystem::isCurrent(vector<string> paths){
+    for (string path : paths){
+        string key;
+        Lookup result = lookup(path, key);
+        if (result != SNAPSHOT_FILE && result != MISSING) continue;
+
+        ErrorOr<vfs::Status> real = base->status(path);
+        bool changed;
+        if (result == MISSING){
+            changed = (bool) real;
+        } else {
+            const FileEntry &entry = files.at(key);
+            changed = !real || real->getSize() != entry.size ||
+                    sys::toTimeT(real->getLastModificationTime()) != entry.modified;
+        }
+
+        if (changed){
+            cerr << "Warning: " << path << " changed since the snapshot was built." << endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Gets the number of files in the snapshot.
+ * @return The number of files.
+ */
+int SnapshotFileSystem::getNumFiles(){
+    return (int) files.size();
+}
+
+/**
+ * Gets the status of a file.
+ * @param path The path to the file.
+ * @return The status of the file.
+ */
+ErrorOr<vfs::Status> SnapshotFileSystem::status(const Twine &path){
+    string key;
+    switch (lookup(path, key)){
+        case SNAPSHOT_FILE: {
+            const FileEntry &entry = files.at(key);
+            return vfs::Status(path.str(), entry.uniqueID, sys::toTimePoint(entry.modified), 0, 0, entry.size,
+                               sys::fs::file_type::regular_file, sys::fs::perms::all_read);
+        }
+        case SNAPSHOT_DIR:
+            return vfs::Status(path.str(), directories.at(key), sys::TimePoint<>(), 0, 0, 0,
+                               sys::fs::file_type::directory_file, sys::fs::perms::all_all);
+        case MISSING:
+            return std::make_error_code(std::errc::no_such_file_or_directory);
+        default:
+            return base->status(path);
+    }
+}
+
+/**
+ * Opens a file for reading.
+ * @param path The path to the file.
+ * @return The opened file.
+ */
+ErrorOr<unique_ptr<vfs::File>> SnapshotFileSystem::openFileForRead(const Twine &path){
+    string key;
+    Lookup result = lookup(path, key);
+    if (result == MISSING) return std::make_error_code(std::errc::no_such_file_or_directory);
+    if (result != SNAPSHOT_FILE) return base->openFileForRead(path);
+
+    const FileEntry &entry = files.at(key);
+    vfs::Status fileStatus(path.str(), entry.uniqueID, sys::toTimePoint(entry.modified), 0, 0, entry.size,
+                           sys::fs::file_type::regular_file, sys::fs::perms::all_read);
+    return unique_ptr<vfs::File>(new SnapshotFile(fileStatus, StringRef(data + entry.offset, entry.size)));
+}
+
+/**
+ * Lists a directory. Snapshot directories are listed from the index so listings
+ * agree with status and open. Other directories come from the base file system.
+ * @param dir The directory to list.
+ * @param ec The error code.
+ * @return The directory iterator.
+ */
+vfs::directory_iterator SnapshotFileSystem::dir_begin(const Twine &dir, error_code &ec){
+    string key;
+    Lookup result = lookup(dir, key);
+    if (result == MISSING || result == SNAPSHOT_FILE){
+        ec = (result == MISSING) ? std::make_error_code(std::errc::no_such_file_or_directory) :
+             std::make_error_code(std::errc::not_a_directory);
+        return vfs::directory_iterator();
+    }
+    if (result != SNAPSHOT_DIR) return base->dir_begin(dir, ec);
+
+    //Entries are named under the directory as it was given.
+    vector<string> entries;
+    auto found = children.find(key);
+    if (found != children.end()){
+        for (string child : found->second){
+            SmallString<256> entry;
+            dir.toVector(entry);
+            sys::path::append(entry, child);
+            entries.push_back(entry.str());
+        }
+    }
+
+    auto iterator = make_shared<SnapshotDirIterator>(this, entries);
+    ec = iterator->increment();
+    return vfs::directory_iterator(iterator);
+}
+
+/**
+ * Sets the working directory used to resolve relative paths.
+ * @param path The new working directory.
+ * @return The error code.
+ */
+error_code SnapshotFileSystem::setCurrentWorkingDirectory(const Twine &path){
+    error_code ec = base->setCurrentWorkingDirectory(path);
+    if (ec) return ec;
+
+    ErrorOr<string> dir = base->getCurrentWorkingDirectory();
+    lock_guard<mutex> lock(dirLock);
+    workingDir = (dir) ? *dir : path.str();
+    return ec;
+}
+
+/**
+ * Gets the working directory used to resolve relative paths.
+ * @return The working directory.
+ */
+ErrorOr<string> SnapshotFileSystem::getCurrentWorkingDirectory() const {
+    lock_guard<mutex> lock(dirLock);
+    return workingDir;
+}
+
+/**
+ * Finds where a path is served from. Paths that aren't in the snapshot but are
+ * inside a snapshot directory don't exist.
+ * @param path The path to look up.
+ * @param key Set to the normalized path.
+ * @return Where the path is served from.
+ */
+SnapshotFileSystem::Lookup SnapshotFileSystem::lookup(const Twine &path, string &key){
+    SmallString<256> absolute;
+    path.toVector(absolute);
+    {
+        lock_guard<mutex> lock(dirLock);
+        sys::fs::make_absolute(workingDir, absolute);
+    }
+    sys::path::remove_dots(absolute);
+
+    //Parent references through a symlinked directory can't be resolved lexically.
+    if (hasPassthroughPrefix(absolute.str())) return PASSTHROUGH;
+    sys::path::remove_dots(absolute, true);
+    key = absolute.str();
+
+    if (files.find(key) != files.end()) return SNAPSHOT_FILE;
+    if (directories.find(key) != directories.end()) return SNAPSHOT_DIR;
+    if (passthrough.find(key) != passthrough.end()) return PASSTHROUGH;
+
+    //Walks up to the closest directory that was captured.
+    for (StringRef parent = sys::path::parent_path(key); !parent.empty(); parent = sys::path::parent_path(parent)){
+        if (passthrough.find(parent.str()) != passthrough.end()) return PASSTHROUGH;
+        if (directories.find(parent.str()) != directories.end()) return MISSING;
+    }
+
+    return PASSTHROUGH;
+}
+
+/**
+ * Checks whether any prefix of a path is passed to the base file system.
+ * @param path The absolute path.
+ * @return Whether a prefix is passed through.
+ */
+bool SnapshotFileSystem::hasPassthroughPrefix(string path){
+    if (passthrough.size() == 0) return false;
+
+    for (size_t split = path.find('/', 1); split != string::npos; split = path.find('/', split + 1)){
+        if (passthrough.find(path.substr(0, split)) != passthrough.end()) return true;
+    }
+    return passthrough.find(path) != passthrough.end();
+}
+
+/**
+ * Normalizes a path the same way lookups do.
+ * @param path The path.
+ * @return The absolute path without dots.
+ */
+string SnapshotFileSystem::normalize(string path){
+    SmallString<256> normalized(path);
+    sys::fs::make_absolute(normalized);
+    sys::path::remove_dots(normalized, true);
+    return normalized.str();
+}
+
+/**
+ * Creates a file that is served from the snapshot.
+ * @param status The status of the file.
+ * @param contents The contents of the file. Always followed by a null.
+ */
+SnapshotFile::SnapshotFile(vfs::Status status, StringRef contents) : fileStatus(status), contents(contents) { }
+
+/**
+ * Gets the status of the file.
+ * @return The status of the file.
+ */
+ErrorOr<vfs::Status> SnapshotFile::status(){
+    return fileStatus;
+}
+
+/**
+ * Gets the contents of the file without copying them.
+ * @param name The name of the buffer.
+ * @param fileSize The expected size of the file.
+ * @param requiresNullTerminator Whether the buffer must end in a null.
+ * @param isVolatile Whether the file may change while it is read.
+ * @return The buffer.
+ */
+ErrorOr<unique_ptr<MemoryBuffer>> SnapshotFile::getBuffer(const Twine &name, int64_t fileSize,
+                                                          bool requiresNullTerminator, bool isVolatile){
+    return MemoryBuffer::getMemBuffer(contents, name.str(), requiresNullTerminator);
+}
+
+/**
+ * Closes the file. Nothing is held open.
+ * @return The error code.
+ */
+error_code SnapshotFile::close(){
+    return error_code();
+}
+
+/**
+ * Creates an iterator over a directory listed from the snapshot.
+ * @param fs The file system the entries are looked up in.
+ * @param entries The paths of the entries.
+ */
+SnapshotDirIterator::SnapshotDirIterator(vfs::FileSystem* fs, vector<string> entries) : fs(fs), entries(entries) { }
+
+/**
+ * Moves to the next entry. Entries that can no longer be found are skipped.
+ * @return The error code.
+ */
+error_code SnapshotDirIterator::increment(){
+    while (next < entries.size()){
+        ErrorOr<vfs::Status> entryStatus = fs->status(entries.at(next++));
+        if (!entryStatus) continue;
+
+        CurrentEntry = *entryStatus;
+        return error_code();
+    }
+
+    CurrentEntry = vfs::Status();
+    return error_code();
+}
@@ -0,0 +1,118 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SnapshotFileSystem.h
+//
+// Packs the source tree and include directories into a single snapshot
+// file and serves them to Clang from memory. Lookups inside the snapshot
+// never touch the original file system, which helps when the sources
+// live on a slow network file system. Files keep their original paths.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CLANGEX_SNAPSHOTFILESYSTEM_H
+#define CLANGEX_SNAPSHOTFILESYSTEM_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <boost/filesystem.hpp>
+#include "clang/Basic/VirtualFileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+class SnapshotFileSystem : public clang::vfs::FileSystem {
+public:
+    /** Constructor */
+    SnapshotFileSystem(llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> base);
+
+    /** Snapshot Operations */
+    static bool build(std::string snapshotFile, std::vector<boost::filesystem::path> roots);
+    bool load(std::string snapshotFile);
+    bool isCurrent(std::vector<std::string> paths);
+    int getNumFiles();
+
+    /** File System Operations */
+    llvm::ErrorOr<clang::vfs::Status> status(const llvm::Twine &path) override;
+    llvm::ErrorOr<std::unique_ptr<clang::vfs::File>> openFileForRead(const llvm::Twine &path) override;
+    clang::vfs::directory_iterator dir_begin(const llvm::Twine &dir, std::error_code &ec) override;
+    std::error_code setCurrentWorkingDirectory(const llvm::Twine &path) override;
+    llvm::ErrorOr<std::string> getCurrentWorkingDirectory() const override;
+
+private:
+    static const std::string SNAPSHOT_HEADER;
+    static const std::string DATA_MARKER;
+    static const uintmax_t MAX_FILE_SIZE = 16 * 1024 * 1024;
+    static const uintmax_t MAX_SNAPSHOT_SIZE = 2048ull * 1024 * 1024;
+
+    /** Snapshot Entries */
+    enum Lookup {SNAPSHOT_FILE, SNAPSHOT_DIR, MISSING, PASSTHROUGH};
+    typedef struct {
+        size_t offset;
+        size_t size;
+        time_t modified;
+        llvm::sys::fs::UniqueID uniqueID;
+    } FileEntry;
+
+    llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> base;
+    std::unique_ptr<llvm::MemoryBuffer> snapshot;
+    const char* data = nullptr;
+    std::unordered_map<std::string, FileEntry> files;
+    std::unordered_map<std::string, llvm::sys::fs::UniqueID> directories;
+    std::unordered_set<std::string> passthrough;
+    std::unordered_map<std::string, std::vector<std::string>> children;
+
+    mutable std::mutex dirLock;
+    std::string workingDir;
+
+    /** Helper Methods */
+    Lookup lookup(const llvm::Twine &path, std::string &key);
+    bool hasPassthroughPrefix(std::string path);
+    static std::string normalize(std::string path);
+};
+
+class SnapshotFile : public clang::vfs::File {
+public:
+    /** Constructor */
+    SnapshotFile(clang::vfs::Status status, llvm::StringRef contents);
+
+    /** File Operations */
+    llvm::ErrorOr<clang::vfs::Status> status() override;
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> getBuffer(const llvm::Twine &name, int64_t fileSize,
+                                                                 bool requiresNullTerminator,
+                                                                 bool isVolatile) override;
+    std::error_code close() override;
+
+private:
+    clang::vfs::Status fileStatus;
+    llvm::StringRef contents;
+};
+
+class SnapshotDirIterator : public clang::vfs::detail::DirIterImpl {
+public:
+    /** Constructor */
+    SnapshotDirIterator(clang::vfs::FileSystem* fs, std::vector<std::string> entries);
+
+    /** Iterator Operations */
+    std::error_code increment() override;
+
+private:
+    clang::vfs::FileSystem* fs;
+    std::vector<std::string> entries;
+    size_t next = 0;
+};
+
+
+#endif //CLANGEX_SNAPSHOTFILESYSTEM_H
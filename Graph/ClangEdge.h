@@ -31,7 +31,7 @@
 #include <vector>
 #include <map>
 #include <iostream>
-#include <boost/tokenizer.hpp>
+#include <unordered_set>
 #include "clang/ASTMatchers/ASTMatchers.h"
 #include "clang/Lex/Lexer.h"
 #include "ClangNode.h"
@@ -46,83 +46,88 @@ private:
         const std::string attrName = "access";
         const std::string READ_FLAG = "read";
         const std::string WRITE_FLAG = "write";
-        const char* assignmentOperators[17] = {"=", "+=", "-=", "*=", "/=", "%=", "<<=", ">>=",
-                                               "&=", "^=", "|=", "&", "|", "^", "~", "<<", ">>"};
-        const char* incDecOperators[2] = {"++", "--"};
 
         /**
          * Gets the access type of variables. Can be either read or writes.
-         * @param expr The expression to investigate.
-         * @param varName The name of the variable to add.
+         * @param written Whether the variable reference is written to.
+         * @return The access flag.
          */
-        std::string getVariableAccess(const clang::Expr *expr,
-                                      const std::string varName){
-            //Generate the printing policy.
-            clang::LangOptions LangOpts;
-            clang::PrintingPolicy Policy(LangOpts);
-
-            //Gets the string.
-            std::string TypeS;
-            llvm::raw_string_ostream s(TypeS);
-            if (expr == nullptr) return ClangEdge::ACCESS_ATTRIBUTE.READ_FLAG;
-            expr->printPretty(s, nullptr, Policy);
-
-            if (s.str().compare("") == 0) return ClangEdge::ACCESS_ATTRIBUTE.READ_FLAG;
-
-            //Get associated strings.
-            std::string varStatement = s.str();
-
-            //First, check if the name of the variable actually appears.
-            if (varStatement.find(varName) == std::string::npos) return ClangEdge::ACCESS_ATTRIBUTE.READ_FLAG;
-
-            //Next, tokenize statement.
-            typedef boost::tokenizer<boost::char_separator<char>> tokenizer;
-            boost::char_separator<char> sep{" "};
-            tokenizer tok{varStatement, sep};
-            std::vector<std::string> statementTokens;
-            for (const auto &t : tok) {
-                statementTokens.push_back(t);
-            }
+        std::string getVariableAccess(bool written){
+            return (written) ? ClangEdge::ACCESS_ATTRIBUTE.WRITE_FLAG : ClangEdge::ACCESS_ATTRIBUTE.READ_FLAG;
+        }
 
-            //Check if we have increment and decrement operators.
-            for (std::string token : statementTokens){
-                //We found our variable.
-                if (token.find(varName) != std::string::npos){
-                    //Next, check for the increment and decrement operators.
-                    for (std::string op : ClangEdge::ACCESS_ATTRIBUTE.incDecOperators){
-                        if (token.compare(op + varName) == 0) return ClangEdge::ACCESS_ATTRIBUTE.WRITE_FLAG;
-                        if (token.compare(varName + op) == 0) return ClangEdge::ACCESS_ATTRIBUTE.WRITE_FLAG;
-                    }
-                }
+        /**
+         * Collects every variable reference that is written to inside a statement.
+         * Assignments, compound assignments and increments/decrements write to their target.
+         * @param stmt The statement to search.
+         * @param writes The set of written references.
+         */
+        void collectWrites(const clang::Stmt *stmt, std::unordered_set<const clang::DeclRefExpr*>& writes){
+            if (stmt == nullptr) return;
+
+            //Gets the target of the write.
+            const clang::Expr *target = nullptr;
+            if (auto *binOp = llvm::dyn_cast<clang::BinaryOperator>(stmt)){
+                if (binOp->isAssignmentOp()) target = binOp->getLHS();
+            } else if (auto *unOp = llvm::dyn_cast<clang::UnaryOperator>(stmt)){
+                if (unOp->isIncrementDecrementOp()) target = unOp->getSubExpr();
+            } else if (auto *opCall = llvm::dyn_cast<clang::CXXOperatorCallExpr>(stmt)){
+                if (opCall->getNumArgs() > 0 && isWriteOperator(opCall->getOperator())) target = opCall->getArg(0);
             }
 
-            //Get the position of the variable name.
-            int pos = find(statementTokens.begin(), statementTokens.end(), varName) - statementTokens.begin();
-
-            //Search vector for C/C++ assignment operators.
-            int i = 0;
-            bool foundAOp = false;
-            for (std::string token : statementTokens) {
-                //Check for a particular assignment operator.
-                for (std::string op : ClangEdge::ACCESS_ATTRIBUTE.assignmentOperators) {
-                    if (token.compare(op) == 0) {
-                        foundAOp = true;
-                        break;
-                    }
-                }
+            const clang::DeclRefExpr *ref = getWrittenReference(target);
+            if (ref != nullptr) writes.insert(ref);
+
+            for (const clang::Stmt *child : stmt->children()) collectWrites(child, writes);
+        }
 
-                //See if we found the operator.
-                if (foundAOp) break;
-                i++;
+        /**
+         * Gets the variable reference that a write lands on. Looks through parentheses,
+         * casts, array and container subscripts, member accesses and dereferences.
+         * Pointer member accesses (p->f = x) stop at the pointer and stay reads like they
+         * always were since the write lands on the object being pointed to.
+         * @param target The expression being written to.
+         * @return The variable reference or null if there is none.
+         */
+        const clang::DeclRefExpr* getWrittenReference(const clang::Expr *target){
+            while (target != nullptr){
+                target = target->IgnoreParenCasts();
+
+                if (auto *ref = llvm::dyn_cast<clang::DeclRefExpr>(target)) return ref;
+                if (auto *subscript = llvm::dyn_cast<clang::ArraySubscriptExpr>(target)){
+                    target = subscript->getBase();
+                } else if (auto *opCall = llvm::dyn_cast<clang::CXXOperatorCallExpr>(target)){
+                    if (opCall->getOperator() != clang::OO_Subscript || opCall->getNumArgs() == 0) return nullptr;
+                    target = opCall->getArg(0);
+                } else if (auto *member = llvm::dyn_cast<clang::MemberExpr>(target)){
+                    if (member->isArrow()) return nullptr;
+                    target = member->getBase();
+                } else if (auto *unOp = llvm::dyn_cast<clang::UnaryOperator>(target)){
+                    if (unOp->getOpcode() != clang::UO_Deref) return nullptr;
+                    target = unOp->getSubExpr();
+                } else {
+                    return nullptr;
+                }
             }
 
-            //Now, we see what side of the operator our variable is on.
-            if (!foundAOp){
-                return ClangEdge::ACCESS_ATTRIBUTE.READ_FLAG;
-            } else if (pos <= i){
-                return ClangEdge::ACCESS_ATTRIBUTE.WRITE_FLAG;
+            return nullptr;
+        }
+
+        /**
+         * Checks whether an overloaded operator writes to its first argument.
+         * @param op The overloaded operator.
+         * @return Whether it is a write.
+         */
+        bool isWriteOperator(clang::OverloadedOperatorKind op){
+            switch (op){
+                case clang::OO_Equal: case clang::OO_PlusEqual: case clang::OO_MinusEqual: case clang::OO_StarEqual:
+                case clang::OO_SlashEqual: case clang::OO_PercentEqual: case clang::OO_CaretEqual:
+                case clang::OO_AmpEqual: case clang::OO_PipeEqual: case clang::OO_LessLessEqual:
+                case clang::OO_GreaterGreaterEqual: case clang::OO_PlusPlus: case clang::OO_MinusMinus:
+                    return true;
+                default:
+                    return false;
             }
-            return ClangEdge::ACCESS_ATTRIBUTE.READ_FLAG;
         }
     } AccessStruct;
 
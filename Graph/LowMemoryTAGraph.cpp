@@ -24,7 +24,18 @@
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include <fstream>
+#include <sstream>
+#include <iostream>
+#include <unordered_set>
+#include <queue>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include <sys/sendfile.h>
 #include <boost/algorithm/string.hpp>
 #include <cstdio>
 #include <boost/filesystem/operations.hpp>
@@ -43,6 +54,8 @@ const string LowMemoryTAGraph::BASE_INSTANCE_FN = "instances.ta";
 const string LowMemoryTAGraph::BASE_RELATION_FN = "relations.ta";
 const string LowMemoryTAGraph::BASE_MV_RELATION_FN = "old.relations.ta";
 const string LowMemoryTAGraph::BASE_ATTRIBUTE_FN = "attributes.ta";
+const string LowMemoryTAGraph::BASE_FILE_INDEX_FN = "fileIndex.txt";
+const string LowMemoryTAGraph::BASE_JOURNAL_FN = "journal.txt";
 
 /**
  * Creates a graph with a base and a specific number.
@@ -57,6 +70,8 @@ LowMemoryTAGraph::LowMemoryTAGraph(string basePath, int curNum) : TAGraph() {
     relationFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_RELATION_FN)).string();
     mvRelationFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_MV_RELATION_FN)).string();
     attributeFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_ATTRIBUTE_FN)).string();
+    fileIndexFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_FILE_INDEX_FN)).string();
+    journalFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_JOURNAL_FN)).string();
     settingFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + CUR_SETTING_LOC)).string();
     curFileFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + CUR_FILE_LOC)).string();
 }
@@ -74,18 +89,26 @@ LowMemoryTAGraph::LowMemoryTAGraph(string basePath) : TAGraph() {
     relationFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_RELATION_FN)).string();
     mvRelationFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_MV_RELATION_FN)).string();
     attributeFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_ATTRIBUTE_FN)).string();
+    fileIndexFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_FILE_INDEX_FN)).string();
+    journalFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_JOURNAL_FN)).string();
     settingFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + CUR_SETTING_LOC)).string();
     curFileFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + CUR_FILE_LOC)).string();
 
     if (doesFileExist(instanceFN)) deleteFile(instanceFN);
     if (doesFileExist(relationFN)) deleteFile(relationFN);
     if (doesFileExist(attributeFN)) deleteFile(attributeFN);
+    if (doesFileExist(fileIndexFN)) deleteFile(fileIndexFN);
+    if (doesFileExist(journalFN)) deleteFile(journalFN);
     std::ofstream f = std::ofstream{ instanceFN };
     f.close();
     f = ofstream{ relationFN };
     f.close();
     f = ofstream{ attributeFN };
     f.close();
+    f = ofstream{ fileIndexFN };
+    f.close();
+    f = ofstream{ journalFN };
+    f.close();
     f = ofstream{ settingFN };
     f.close();
     f = ofstream{ curFileFN };
@@ -104,18 +127,26 @@ LowMemoryTAGraph::LowMemoryTAGraph() : TAGraph() {
     relationFN = bs::weakly_canonical(bs::path(to_string(fileNumber) + "-" + BASE_RELATION_FN)).string();
     mvRelationFN = bs::weakly_canonical(bs::path(to_string(fileNumber) + "-" + BASE_MV_RELATION_FN)).string();
     attributeFN = bs::weakly_canonical(bs::path(to_string(fileNumber) + "-" + BASE_ATTRIBUTE_FN)).string();
+    fileIndexFN = bs::weakly_canonical(bs::path(to_string(fileNumber) + "-" + BASE_FILE_INDEX_FN)).string();
+    journalFN = bs::weakly_canonical(bs::path(to_string(fileNumber) + "-" + BASE_JOURNAL_FN)).string();
     settingFN = bs::weakly_canonical(bs::path(to_string(fileNumber) + "-" + CUR_SETTING_LOC)).string();
     curFileFN = bs::weakly_canonical(bs::path(to_string(fileNumber) + "-" + CUR_FILE_LOC)).string();
 
     if (doesFileExist(instanceFN)) deleteFile(instanceFN);
     if (doesFileExist(relationFN)) deleteFile(relationFN);
     if (doesFileExist(attributeFN)) deleteFile(attributeFN);
+    if (doesFileExist(fileIndexFN)) deleteFile(fileIndexFN);
+    if (doesFileExist(journalFN)) deleteFile(journalFN);
     std::ofstream f = std::ofstream{ instanceFN };
     f.close();
     f = ofstream{ relationFN };
     f.close();
     f = ofstream{ attributeFN };
     f.close();
+    f = ofstream{ fileIndexFN };
+    f.close();
+    f = ofstream{ journalFN };
+    f.close();
     f = ofstream{ settingFN };
     f.close();
     f = ofstream{ curFileFN };
@@ -127,13 +158,24 @@ LowMemoryTAGraph::LowMemoryTAGraph() : TAGraph() {
  * Deletes all the files to disk.
  */
 LowMemoryTAGraph::~LowMemoryTAGraph() {
+    if (keepFiles) return;
+
     if (doesFileExist(instanceFN)) deleteFile(instanceFN);
     if (doesFileExist(relationFN)) deleteFile(relationFN);
     if (doesFileExist(attributeFN)) deleteFile(attributeFN);
+    if (doesFileExist(fileIndexFN)) deleteFile(fileIndexFN);
+    if (doesFileExist(journalFN)) deleteFile(journalFN);
     if (doesFileExist(settingFN)) deleteFile(settingFN);
     if (doesFileExist(curFileFN)) deleteFile(curFileFN);
 }
 
+/**
+ * Leaves the spill files on disk when the graph is deleted.
+ */
+void LowMemoryTAGraph::keepSpillFiles(){
+    keepFiles = true;
+}
+
 /**
  * Changes where the graph is located.
  * @param basePath The base path to change the location.
@@ -143,6 +185,8 @@ void LowMemoryTAGraph::changeRoot(std::string basePath){
     relationFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_RELATION_FN)).string();
     mvRelationFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_MV_RELATION_FN)).string();
     attributeFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_ATTRIBUTE_FN)).string();
+    fileIndexFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_FILE_INDEX_FN)).string();
+    journalFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + BASE_JOURNAL_FN)).string();
     settingFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + CUR_SETTING_LOC)).string();
     curFileFN = bs::weakly_canonical(bs::path(basePath + "/" + to_string(fileNumber) + "-" + CUR_FILE_LOC)).string();
 }
@@ -181,6 +225,14 @@ bool LowMemoryTAGraph::addEdge(ClangEdge* edge, bool assumeValid){
     return TAGraph::addEdge(edge, assumeValid);
 }
 
+/**
+ * Adds a batch of edges. Each edge goes through addEdge so the graph is purged as it fills up.
+ * @param edges The edges to add.
+ */
+void LowMemoryTAGraph::addEdges(vector<ClangEdge*> edges){
+    for (ClangEdge* edge : edges) addEdge(edge);
+}
+
 /**
  * Generates the TA for this graph.
  * @return The TA format.
@@ -210,16 +262,40 @@ string LowMemoryTAGraph::generateTAFormat() {
     return format;
 }
 
+/**
+ * Writes the TA for this graph to a file. Streams the header and then
+ * splices each spill file into the destination so the model is never held in memory.
+ * @param fileName The file to write to.
+ * @return Whether the file was written.
+ */
+bool LowMemoryTAGraph::writeTAFormat(string fileName){
+    int taFile = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (taFile < 0) return false;
+
+    //Writes the header followed by the instances and relations.
+    string header = generateTAHeader() + "FACT TUPLE :\n";
+    string attrHeader = "\nFACT ATTRIBUTE :\n";
+    bool succ = writeBlock(taFile, header.c_str(), header.size()) &&
+                spliceFile(taFile, instanceFN) &&
+                spliceFile(taFile, relationFN) &&
+                writeBlock(taFile, attrHeader.c_str(), attrHeader.size()) &&
+                spliceFile(taFile, attributeFN);
+
+    if (close(taFile) != 0) succ = false;
+    return succ;
+}
+
 /**
  * Resolves files on disk.
  * @param exclusions The exclusions to process.
+ * @param numThreads The number of threads that build the file tree.
  */
-void LowMemoryTAGraph::resolveFiles(ClangExclude exclusions){
+void LowMemoryTAGraph::resolveFiles(ClangExclude exclusions, int numThreads){
     //Disable purging.
     setPurgeStatus(false);
 
     //Recover files.
-    TAGraph::resolveFiles(exclusions);
+    TAGraph::resolveFiles(exclusions, numThreads);
     setPurgeStatus(true);
 
     //Purge the results.
@@ -232,13 +308,60 @@ void LowMemoryTAGraph::resolveFiles(ClangExclude exclusions){
  * @param silent Whether we should print silently.
  */
 void LowMemoryTAGraph::resolveExternalReferences(Printer* print, bool silent) {
+    if (!compactSpillFiles(print, silent)) cerr << "Compact Error: The graph could not be compacted." << endl;
+}
+
+/**
+ * Resolves external references and compacts the spill files. The compacted files are
+ * written next to the originals and only replace them once everything is written, so a
+ * failure leaves the graph as it was.
+ * @param print The printer that prints messages.
+ * @param silent Whether we should print silently.
+ * @return Whether the graph was compacted.
+ */
+bool LowMemoryTAGraph::compactSpillFiles(Printer* print, bool silent) {
     //First, purge the current graph.
     purgeCurrentGraph();
+    flushJournal();
+
+    string compactInstanceFN = instanceFN + COMPACT_EXT;
+    string compactRelationFN = relationFN + COMPACT_EXT;
+    string compactAttributeFN = attributeFN + COMPACT_EXT;
+    try {
+        if (!writeCompactFiles(print, silent, compactInstanceFN, compactRelationFN, compactAttributeFN)){
+            throw runtime_error("The compacted spill files could not be written.");
+        }
 
+        //Swaps in the compacted files. The journal only describes the raw spill segments so it is retired.
+        bs::rename(compactInstanceFN, instanceFN);
+        bs::rename(compactRelationFN, relationFN);
+        bs::rename(compactAttributeFN, attributeFN);
+        deleteFile(journalFN);
+    } catch (std::exception& e) {
+        if (doesFileExist(compactInstanceFN)) deleteFile(compactInstanceFN);
+        if (doesFileExist(compactRelationFN)) deleteFile(compactRelationFN);
+        if (doesFileExist(compactAttributeFN)) deleteFile(compactAttributeFN);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Writes the compacted instances, relations and attributes.
+ * @param print The printer that prints messages.
+ * @param silent Whether we should print silently.
+ * @param outInstanceFN The file the instances are written to.
+ * @param outRelationFN The file the relations are written to.
+ * @param outAttributeFN The file the attributes are written to.
+ * @return Whether the files were written.
+ */
+bool LowMemoryTAGraph::writeCompactFiles(Printer* print, bool silent, string outInstanceFN, string outRelationFN,
+                                         string outAttributeFN) {
     //Generate a map of the instances.
     unordered_map<string, string> instanceMap;
     ifstream instances(instanceFN);
-    if (!instances.is_open()) return;
+    if (!instances.is_open()) return false;
 
     string curLine;
     while (getline(instances, curLine)){
@@ -251,18 +374,16 @@ void LowMemoryTAGraph::resolveExternalReferences(Printer* print, bool silent) {
         }
     }
     instances.close();
-    deleteFile(instanceFN);
+    numInstances = (int) instanceMap.size();
 
     //Next, resolves the relations.
-    bs::path org = relationFN;
-    bs::path dst = mvRelationFN;
-    rename(org, dst);
-
     vector<string> removedRels;
+    numResolved = 0;
+    numUnresolved = 0;
 
-    ifstream original(mvRelationFN);
-    ofstream destination(relationFN, std::ios_base::out);
-    if (!original.is_open() || !destination.is_open()) return;
+    ifstream original(relationFN);
+    ofstream destination(outRelationFN, std::ios_base::out);
+    if (!original.is_open() || !destination.is_open()) return false;
     while(getline(original, curLine)){
         vector<string> lineSplit = tokenize(curLine);
         if (lineSplit.size() != 3) continue;
@@ -271,19 +392,22 @@ void LowMemoryTAGraph::resolveExternalReferences(Printer* print, bool silent) {
         if (instanceMap.find(lineSplit.at(1)) == instanceMap.end() ||
                 instanceMap.find(lineSplit.at(2)) == instanceMap.end()){
             removedRels.push_back(lineSplit.at(0) + " " + lineSplit.at(1) + " " + lineSplit.at(2));
+            numUnresolved++;
             continue;
         }
 
         destination << curLine << "\n";
+        numResolved++;
     }
     original.close();
     destination.close();
-    deleteFile(mvRelationFN);
+    if (destination.fail()) return false;
+    if (!silent) print->printResolveRefDone(numResolved, numUnresolved);
 
     //Compress attributes.
     unordered_map<string, vector<pair<string, vector<string>>>> attrMap;
     ifstream attributes(attributeFN);
-    if (!attributes.is_open()) return;
+    if (!attributes.is_open()) return false;
 
     while(getline(attributes, curLine)) {
         //Prepare the line.
@@ -382,8 +506,8 @@ void LowMemoryTAGraph::resolveExternalReferences(Printer* print, bool silent) {
     attributes.close();
 
     //Write the attributes.
-    ofstream destAttr(attributeFN, std::ios_base::out);
-    if (!destAttr.is_open()) return;
+    ofstream destAttr(outAttributeFN, std::ios_base::out);
+    if (!destAttr.is_open()) return false;
     for (auto entry : attrMap){
         string attrLine = entry.first + " { ";
 
@@ -400,94 +524,132 @@ void LowMemoryTAGraph::resolveExternalReferences(Printer* print, bool silent) {
     }
     attrMap.clear();
     destAttr.close();
+    if (destAttr.fail()) return false;
 
     //Write the instances.
-    ofstream outI(instanceFN);
-    if (!outI.is_open()) return;
+    ofstream outI(outInstanceFN);
+    if (!outI.is_open()) return false;
 
     for (auto it : instanceMap) {
         outI << INSTANCE_FLAG << " " << it.first << " " << it.second << "\n";
     }
     outI.close();
+    return !outI.fail();
+}
+
+/**
+ * Gets the number of relations kept by the last resolution.
+ * @return The number of resolved relations.
+ */
+int LowMemoryTAGraph::getNumResolved(){
+    return numResolved;
+}
+
+/**
+ * Gets the number of relations dropped by the last resolution.
+ * @return The number of unresolved relations.
+ */
+int LowMemoryTAGraph::getNumUnresolved(){
+    return numUnresolved;
+}
+
+/**
+ * Gets the number of distinct nodes found by the last resolution.
+ * @return The number of nodes.
+ */
+int LowMemoryTAGraph::getNumNodes(){
+    return numInstances;
 }
 
 /**
- * Adds nodes to a file system.
+ * Gets the number of relations kept by the last resolution.
+ * @return The number of edges.
+ */
+int LowMemoryTAGraph::getNumEdges(){
+    return numResolved;
+}
+
+/**
+ * Adds a path to the graph. New paths are journaled so a resumed run
+ * still knows the files seen by the translation units it skips.
+ * @param path The path to add.
+ * @return Whether the path is new.
+ */
+bool LowMemoryTAGraph::addPath(string path){
+    if (!TAGraph::addPath(path)) return false;
+
+    pendingJournal += "P " + to_string(segmentNum) + " " + path + "\n";
+    return true;
+}
+
+/**
+ * Adds nodes to a file system. Sorts the file index that was written during each
+ * purge, drops repeated spills while streaming it and appends the edges to the relations.
  * @param fileSkip Whether we skip files.
  */
 void LowMemoryTAGraph::addNodesToFile(std::map<std::string, ClangNode*> fileSkip){
-    //Load in each attribute.
-    ifstream attributes(attributeFN);
-    if (!attributes.is_open()) return;
+    //Sorts the index so every spill of an entity ends up on adjacent lines.
+    string sortedFN = fileIndexFN + ".sorted";
+    if (doesFileExist(sortedFN)) deleteFile(sortedFN);
+    if (!doesFileExist(fileIndexFN) || !mergeSpillFiles({fileIndexFN}, sortedFN)){
+        if (doesFileExist(sortedFN)) deleteFile(sortedFN);
+        return;
+    }
 
-    string current;
-    while (getline(attributes, current)){
-        boost::algorithm::trim(current);
-
-        //Check for a relation attribute.
-        if (current.at(0) == '(') continue;
-
-        //Get the name and attributes.
-        string name = current.substr(0, current.find(" { "));
-        string attrs = current.substr(current.find(" { ") + 3);
-        attrs.pop_back();
-        attrs.pop_back();
-
-        //Split by space.
-        vector<string> tokens;
-        boost::algorithm::split(tokens, attrs, boost::is_any_of(" "));
-
-        //Process the attributes.
-        string attrValue;
-        int pos = 0;
-        bool doNotCheck = false;
-        for (string curTok : tokens){
-            boost::algorithm::trim(curTok);
-
-            //Check the value of pos.
-            if (pos == 0){
-                if (curTok == FILE_ATTRIBUTE){
-                    doNotCheck = false;
-                } else {
-                    doNotCheck = true;
-                }
-            } else if (pos == 2 ) {
-                pos = -1;
-                if (doNotCheck == true) {
-                    pos = 0;
-                    continue;
-                }
+    ifstream fileIndex(sortedFN);
+    ofstream relations(relationFN, std::ios::out | std::ios::app);
+    if (!fileIndex.is_open() || !relations.is_open()){
+        deleteFile(sortedFN);
+        return;
+    }
 
-                //Add the file node.
-                string file = curTok;
-                ClangNode* fileNode;
-                if (file.compare("") != 0) {
-                    //Find the appropriate node.
-                    vector<ClangNode*> fileVec = findNodeByName(file);
-                    if (fileVec.size() > 0) {
-                        fileNode = fileVec.at(0);
-
-                        //We now look up the file node.
-                        auto ptrSkip = fileSkip.find(file);
-                        if (ptrSkip != fileSkip.end()) {
-                            ClangNode *skip = ptrSkip->second;
-                            fileNode = skip;
-                        }
-                    } else {
-                        continue;
-                    }
+    //Caches the file node for each file name.
+    unordered_map<string, ClangNode*> fileNodes;
+    string lastID;
+    string batch;
+    int batchSize = 0;
 
-                    //Add it to the graph.
-                    ClangEdge *edge = new ClangEdge(fileNode, file, ClangEdge::FILE_CONTAIN);
-                    addEdge(edge);
-                }
-            }
+    string current;
+    while (getline(fileIndex, current)){
+        //Each line is an entity ID followed by its file.
+        size_t split = current.find(' ');
+        if (split == string::npos) continue;
+        string ID = current.substr(0, split);
+        string file = current.substr(split + 1);
+
+        //Entities can be spilled more than once.
+        if (file.compare("") == 0 || ID.compare(lastID) == 0) continue;
+        lastID = ID;
+
+        //Find the appropriate node.
+        ClangNode* fileNode = nullptr;
+        auto cached = fileNodes.find(file);
+        if (cached != fileNodes.end()){
+            fileNode = cached->second;
+        } else {
+            vector<ClangNode*> fileVec = findNodeByName(file);
+            if (fileVec.size() > 0) {
+                fileNode = fileVec.at(0);
 
-            pos++;
+                //We now look up the file node.
+                auto ptrSkip = fileSkip.find(file);
+                if (ptrSkip != fileSkip.end()) fileNode = ptrSkip->second;
+            }
+            fileNodes[file] = fileNode;
         }
+        if (fileNode == nullptr) continue;
+
+        //Writes the edges to the relations in batches.
+        batch += ClangEdge::getTypeString(ClangEdge::FILE_CONTAIN) + " " + fileNode->getID() + " " + ID + "\n";
+        if (++batchSize < PURGE_AMOUNT) continue;
+        relations << batch;
+        batch.clear();
+        batchSize = 0;
     }
-
-    attributes.close();
+    relations << batch;
+    relations.close();
+    fileIndex.close();
+    deleteFile(sortedFN);
 }
 
 /**
@@ -510,8 +672,10 @@ void LowMemoryTAGraph::dumpCurrentFile(int fileNum, string file){
  * @param files The files being processed.
  * @param exclude The exclusions.
  * @param blobMode Blob mode toggle.
+ * @param settings The generation settings. One per line.
  */
-void LowMemoryTAGraph::dumpSettings(vector<bs::path> files, TAGraph::ClangExclude exclude, bool blobMode){
+void LowMemoryTAGraph::dumpSettings(vector<bs::path> files, TAGraph::ClangExclude exclude, bool blobMode,
+                                    vector<string> settings){
     //Opens the file.
     std::ofstream curSettings(settingFN);
     if (!curSettings.is_open()) return;
@@ -526,7 +690,10 @@ void LowMemoryTAGraph::dumpSettings(vector<bs::path> files, TAGraph::ClangExclud
     //Next, dump the excludes.
     curSettings << exclude.cClass << exclude.cEnum << exclude.cFile << exclude.cFunction << exclude.cStruct <<
                 exclude.cSubSystem << exclude.cUnion << exclude.cVariable;
-    curSettings << blobMode;
+    curSettings << blobMode << endl;
+
+    //Finally, dump the generation settings.
+    for (string setting : settings) curSettings << setting << endl;
     curSettings.close();
 }
 
@@ -548,6 +715,115 @@ void LowMemoryTAGraph::deleteFile(string fN) {
     remove(fN.c_str());
 }
 
+/**
+ * Writes a block of data to an open file.
+ * @param fd The file descriptor to write to.
+ * @param data The data to write.
+ * @param size The number of bytes to write.
+ * @return Whether the block was written.
+ */
+bool LowMemoryTAGraph::writeBlock(int fd, const char* data, size_t size){
+    size_t remaining = size;
+
+    while (remaining > 0){
+        ssize_t written = write(fd, data, remaining);
+        if (written < 0){
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        data += written;
+        remaining -= written;
+    }
+
+    return true;
+}
+
+/**
+ * Copies the contents of a file onto the end of an open file. Uses sendfile so the
+ * kernel moves the data and falls back to large block copies if that isn't supported.
+ * @param fd The file descriptor to write to.
+ * @param fN The file to copy.
+ * @return Whether the file was copied.
+ */
+bool LowMemoryTAGraph::spliceFile(int fd, string fN){
+    //A missing spill file is simply empty.
+    int src = open(fN.c_str(), O_RDONLY);
+    if (src < 0) return !doesFileExist(fN);
+
+    struct stat srcStat;
+    if (fstat(src, &srcStat) != 0){
+        close(src);
+        return false;
+    }
+
+    //First, try to have the kernel copy the file.
+    off_t remaining = srcStat.st_size;
+    bool fallback = false;
+    while (remaining > 0){
+        ssize_t sent = sendfile(fd, src, nullptr, (size_t) remaining);
+        if (sent < 0){
+            if (errno == EINTR) continue;
+            if ((errno == EINVAL || errno == ENOSYS) && remaining == srcStat.st_size) fallback = true;
+            else {
+                close(src);
+                return false;
+            }
+            break;
+        } else if (sent == 0){
+            break;
+        }
+
+        remaining -= sent;
+    }
+
+    //Otherwise, copy in large blocks.
+    if (fallback){
+        vector<char> buffer((size_t) COPY_BLOCK_SIZE);
+        ssize_t numRead;
+        while ((numRead = read(src, buffer.data(), buffer.size())) != 0){
+            if (numRead < 0){
+                if (errno == EINTR) continue;
+                close(src);
+                return false;
+            }
+
+            if (!writeBlock(fd, buffer.data(), (size_t) numRead)){
+                close(src);
+                return false;
+            }
+        }
+    }
+
+    close(src);
+    return true;
+}
+
+/**
+ * Syncs the contents of a file to disk.
+ * @param fN The file to sync.
+ * @return Whether the file was synced.
+ */
+bool LowMemoryTAGraph::syncFile(string fN){
+    int fd = open(fN.c_str(), O_RDONLY);
+    if (fd < 0) return !doesFileExist(fN);
+
+    bool succ = fsync(fd) == 0;
+    close(fd);
+    return succ;
+}
+
+/**
+ * Gets the size of a file.
+ * @param fN The file to check.
+ * @return The size of the file or 0 if it doesn't exist.
+ */
+long long LowMemoryTAGraph::getFileSize(string fN){
+    struct stat buffer;
+    if (stat(fN.c_str(), &buffer) != 0) return 0;
+    return (long long) buffer.st_size;
+}
+
 /**
  * Alters whether we purge.
  * @param purge The purge toggle.
@@ -578,10 +854,228 @@ void LowMemoryTAGraph::purgeCurrentGraph(){
     attributes << generateAttributes();
     attributes.close();
 
+    //Records which file each entity belongs to.
+    ofstream fileIndex(fileIndexFN, std::ios::out | std::ios::app);
+    if (!fileIndex.is_open()) return;
+    for (auto it = nodeList.begin(); it != nodeList.end(); it++){
+        if (!it->second) continue;
+
+        vector<string> fileAttrVec = it->second->getAttribute(FILE_ATTRIBUTE);
+        if (fileAttrVec.size() != 1) continue;
+        fileIndex << it->first << " " << fileAttrVec.at(0) << "\n";
+    }
+    fileIndex.close();
+
+    //Records the segment boundary.
+    pendingJournal += "S " + to_string(segmentNum) + " " + to_string(getFileSize(instanceFN)) + " " +
+            to_string(getFileSize(relationFN)) + " " + to_string(getFileSize(attributeFN)) + " " +
+            to_string(getFileSize(fileIndexFN)) + "\n";
+    segmentNum++;
+
     //Clear the graph.
     clearGraph();
 }
 
+/**
+ * Marks a file as completed. Purges the graph so the file's facts end on a segment
+ * boundary and group commits the journal once enough records are pending.
+ * @param fileNum The file number.
+ * @param file The file that was completed.
+ */
+void LowMemoryTAGraph::commitFile(int fileNum, string file){
+    purgeCurrentGraph();
+
+    //Records the completed file against the last segment.
+    pendingJournal += "T " + to_string(segmentNum - 1) + " " + to_string(fileNum) + " " + file + "\n";
+    pendingRecords++;
+
+    if (pendingRecords >= JOURNAL_GROUP || difftime(time(nullptr), lastCommit) >= JOURNAL_INTERVAL) flushJournal();
+}
+
+/**
+ * Commits all pending journal records. The spill files are synced first so
+ * every segment in the journal is durable on disk before it is recorded.
+ */
+void LowMemoryTAGraph::flushJournal(){
+    lastCommit = time(nullptr);
+    if (pendingJournal.empty()) return;
+
+    //Syncs the spill files.
+    if (!syncFile(instanceFN) || !syncFile(relationFN) || !syncFile(attributeFN) || !syncFile(fileIndexFN)){
+        cerr << "Journal Error: The spill files could not be synced to disk." << endl;
+        return;
+    }
+
+    //Appends and syncs the journal.
+    int journal = open(journalFN.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (journal < 0){
+        cerr << "Journal Error: The journal " << journalFN << " could not be opened." << endl;
+        return;
+    }
+
+    bool succ = writeBlock(journal, pendingJournal.c_str(), pendingJournal.size()) && fsync(journal) == 0;
+    if (close(journal) != 0) succ = false;
+    if (!succ){
+        cerr << "Journal Error: The journal " << journalFN << " could not be written." << endl;
+        return;
+    }
+
+    pendingJournal.clear();
+    pendingRecords = 0;
+}
+
+/**
+ * Recovers the graph from its journal. Truncates the spill files to the segment
+ * of the last completed file and gets every file that was already completed.
+ * @param completed The set of completed file numbers.
+ * @return Whether a journal was found.
+ */
+bool LowMemoryTAGraph::recoverJournal(unordered_set<int>* completed){
+    ifstream journal(journalFN);
+    if (!journal.is_open()) return false;
+
+    //Reads each record. A partially written record at the end is ignored.
+    unordered_map<int, vector<long long>> segments;
+    vector<pair<int, string>> paths;
+    int lastSegment = -1;
+    int maxSegment = -1;
+    string curLine;
+    while (getline(journal, curLine)){
+        if (journal.eof()) break;
+
+        stringstream record(curLine);
+        string type;
+        int segment;
+        record >> type >> segment;
+        if (record.fail()) continue;
+
+        if (type == "S"){
+            vector<long long> sizes(4);
+            for (int i = 0; i < 4; i++) record >> sizes[i];
+            if (record.fail()) continue;
+
+            segments[segment] = sizes;
+            if (segment > maxSegment) maxSegment = segment;
+        } else if (type == "T"){
+            int fileNum;
+            record >> fileNum;
+            if (record.fail()) continue;
+
+            completed->insert(fileNum);
+            lastSegment = segment;
+        } else if (type == "P"){
+            string path;
+            getline(record >> ws, path);
+            if (!path.empty()) paths.push_back(make_pair(segment, path));
+        }
+    }
+    journal.close();
+
+    //Restores the paths seen by the completed files.
+    for (auto path : paths){
+        if (path.first <= lastSegment) TAGraph::addPath(path.second);
+    }
+
+    //Truncates the spill files to the last consistent segment.
+    vector<long long> sizes(4, 0);
+    if (segments.find(lastSegment) != segments.end()) sizes = segments[lastSegment];
+    if (truncate(instanceFN.c_str(), sizes[0]) != 0 || truncate(relationFN.c_str(), sizes[1]) != 0 ||
+            truncate(attributeFN.c_str(), sizes[2]) != 0 ||
+            (doesFileExist(fileIndexFN) && truncate(fileIndexFN.c_str(), sizes[3]) != 0)){
+        cerr << "Journal Error: The spill files could not be truncated." << endl;
+    }
+
+    segmentNum = maxSegment + 1;
+    return true;
+}
+
+/**
+ * Merges a set of spill files into a destination file. Each source is split into
+ * sorted runs of a bounded size which are then k-way merged, dropping duplicates.
+ * @param sources The files to merge.
+ * @param dest The file to append the merged lines to.
+ * @return Whether the merge was successful.
+ */
+bool LowMemoryTAGraph::mergeSpillFiles(vector<string> sources, string dest){
+    vector<string> runs;
+    bool succ = true;
+
+    //Creates the sorted runs.
+    for (string source : sources){
+        ifstream input(source);
+        if (!input.is_open()) continue;
+
+        vector<string> lines;
+        string curLine;
+        bool more = true;
+        while (more){
+            more = static_cast<bool>(getline(input, curLine));
+            if (more && !curLine.empty()) lines.push_back(curLine);
+            if (lines.size() < MERGE_RUN_LINES && more) continue;
+            if (lines.empty()) continue;
+
+            //Writes the run.
+            sort(lines.begin(), lines.end());
+            lines.erase(unique(lines.begin(), lines.end()), lines.end());
+
+            string runFN = dest + ".run" + to_string(runs.size());
+            ofstream run(runFN);
+            if (!run.is_open()){
+                succ = false;
+                break;
+            }
+            for (string line : lines) run << line << "\n";
+            run.close();
+
+            runs.push_back(runFN);
+            lines.clear();
+        }
+        input.close();
+        if (!succ) break;
+    }
+
+    //Performs the k-way merge.
+    if (succ){
+        ofstream output(dest, std::ios::out | std::ios::app);
+        if (!output.is_open()) succ = false;
+
+        vector<ifstream*> inputs;
+        priority_queue<pair<string, int>, vector<pair<string, int>>, greater<pair<string, int>>> heads;
+        for (int i = 0; succ && i < runs.size(); i++){
+            inputs.push_back(new ifstream(runs.at(i)));
+
+            string curLine;
+            if (getline(*inputs.at(i), curLine)) heads.push(make_pair(curLine, i));
+        }
+
+        string last;
+        bool written = false;
+        while (!heads.empty()){
+            pair<string, int> head = heads.top();
+            heads.pop();
+
+            if (!written || head.first != last){
+                output << head.first << "\n";
+                last = head.first;
+                written = true;
+            }
+
+            string curLine;
+            if (getline(*inputs.at(head.second), curLine)) heads.push(make_pair(curLine, head.second));
+        }
+
+        for (auto input : inputs) delete input;
+        if (output.is_open()) output.close();
+        if (output.fail()) succ = false;
+    }
+
+    //Removes the runs.
+    for (string run : runs) deleteFile(run);
+
+    if (!succ) cerr << "Merge Error: The spill file " << dest << " could not be merged." << endl;
+    return succ;
+}
+
 /**
  * Gets the number of entities in the graph.
  * @return The number of entities in the graph.
@@ -27,6 +27,8 @@
 #define CLANGEX_LOWMEMORYTAGRAPH_H
 
 #include <string>
+#include <ctime>
+#include <unordered_set>
 #include <boost/filesystem.hpp>
 #include "../Printer/Printer.h"
 #include "TAGraph.h"
@@ -41,51 +43,93 @@ public:
 
     /** Changes the Root */
     void changeRoot(std::string basePath);
+    void keepSpillFiles();
 
     /** Node Adders */
     bool addNode(ClangNode* node, bool assumeValid = false) override;
     bool addEdge(ClangEdge* edge, bool assumeValid = false) override;
+    void addEdges(std::vector<ClangEdge*> edges) override;
 
     /** TA Generation */
     std::string generateTAFormat() override;
-    void resolveFiles(ClangExclude exclusions) override;
+    bool writeTAFormat(std::string fileName) override;
+    void resolveFiles(ClangExclude exclusions, int numThreads = 1) override;
     void resolveExternalReferences(Printer* print, bool silent = false) override;
+    bool compactSpillFiles(Printer* print, bool silent = false);
+
+    /** Resolution Counts */
+    int getNumResolved();
+    int getNumUnresolved();
+    int getNumNodes() override;
+    int getNumEdges() override;
 
     /** File System Adders */
     void addNodesToFile(std::map<std::string, ClangNode*> fileSkip) override;
+    bool addPath(std::string path) override;
 
     /** Settings/File Dumpers */
     void dumpCurrentFile(int fileNum, std::string file);
-    void dumpSettings(std::vector<boost::filesystem::path> files,
-                      TAGraph::ClangExclude exclude, bool blobMode);
+    void dumpSettings(std::vector<boost::filesystem::path> files, TAGraph::ClangExclude exclude, bool blobMode,
+                      std::vector<std::string> settings = std::vector<std::string>());
 
     /** TA Dumper */
     void purgeCurrentGraph();
 
+    /** Journal System */
+    void commitFile(int fileNum, std::string file);
+    void flushJournal();
+    bool recoverJournal(std::unordered_set<int>* completed);
+
     static const std::string CUR_FILE_LOC;
     static const std::string CUR_SETTING_LOC;
     static const std::string BASE_INSTANCE_FN;
     static const std::string BASE_RELATION_FN;
     static const std::string BASE_MV_RELATION_FN;
     static const std::string BASE_ATTRIBUTE_FN;
+    static const std::string BASE_FILE_INDEX_FN;
+    static const std::string BASE_JOURNAL_FN;
 
 private:
     const int PURGE_AMOUNT = 1000;
+    const int COPY_BLOCK_SIZE = 1048576;
+    const int JOURNAL_GROUP = 16;
+    const int JOURNAL_INTERVAL = 30;
+    const int MERGE_RUN_LINES = 250000;
+    const std::string COMPACT_EXT = ".compact";
 
     std::string instanceFN;
     std::string relationFN;
     std::string mvRelationFN;
     std::string attributeFN;
+    std::string fileIndexFN;
+    std::string journalFN;
     std::string settingFN;
     std::string curFileFN;
 
     static int currentNumber;
     int fileNumber;
     bool purge;
+    bool keepFiles = false;
+    int numResolved = 0;
+    int numUnresolved = 0;
+    int numInstances = 0;
+
+    /** Journal Variables */
+    int segmentNum = 0;
+    int pendingRecords = 0;
+    std::string pendingJournal;
+    time_t lastCommit = time(nullptr);
 
     /** File Operations */
     bool doesFileExist(std::string fN);
     void deleteFile(std::string fN);
+    bool writeBlock(int fd, const char* data, size_t size);
+    bool spliceFile(int fd, std::string fN);
+    bool syncFile(std::string fN);
+    long long getFileSize(std::string fN);
+    bool mergeSpillFiles(std::vector<std::string> sources, std::string dest);
+    bool writeCompactFiles(Printer* print, bool silent, std::string outInstanceFN, std::string outRelationFN,
+                           std::string outAttributeFN);
 
     /** Helper Methods */
     void setPurgeStatus(bool purge);
@@ -26,6 +26,8 @@
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include <ctime>
+#include <fstream>
+#include <unordered_set>
 #include "TAGraph.h"
 #include "../Walker/ASTWalker.h"
 
@@ -103,6 +105,57 @@ bool TAGraph::addEdge(ClangEdge *edge, bool assumeValid) {
     return true;
 }
 
+/**
+ * Adds a batch of edges to the TA graph. Duplicates are found with a single set
+ * for the whole batch instead of scanning the source's edges for every edge.
+ * @param edges The edges to add.
+ */
+void TAGraph::addEdges(vector<ClangEdge*> edges) {
+    unordered_set<string> existing;
+    unordered_set<string> seenSrc;
+
+    for (ClangEdge *edge : edges) {
+        //Seeds the set with the edges already leaving the source.
+        if (seenSrc.insert(edge->getSrcID()).second) {
+            auto srcEdges = edgeSrcList.find(edge->getSrcID());
+            if (srcEdges != edgeSrcList.end()) {
+                for (ClangEdge *curEdge : srcEdges->second) {
+                    existing.insert(curEdge->getSrcID() + " " + curEdge->getDstID() + " " +
+                                    to_string(curEdge->getType()));
+                }
+            }
+        }
+
+        //Check if the edge already exists.
+        string key = edge->getSrcID() + " " + edge->getDstID() + " " + to_string(edge->getType());
+        if (!existing.insert(key).second ||
+                (edge->getSrcID().compare(edge->getDstID()) == 0 && edge->getType() == ClangEdge::EdgeType::CONTAINS)) {
+            delete edge;
+            continue;
+        }
+
+        //Now, check if we already have a contains edge for the source node.
+        if (edge->getType() == ClangEdge::EdgeType::CONTAINS) {
+            auto dstEdges = edgeDstList.find(edge->getDstID());
+            if (dstEdges != edgeDstList.end()) {
+                vector<ClangEdge *> curEdges = dstEdges->second;
+                for (ClangEdge *curEdge : curEdges) {
+                    if (curEdge->getType() != ClangEdge::EdgeType::CONTAINS) continue;
+
+                    //Removed edges can be added again later in the batch.
+                    existing.erase(curEdge->getSrcID() + " " + curEdge->getDstID() + " " +
+                                   to_string(curEdge->getType()));
+                    removeEdge(curEdge);
+                }
+            }
+        }
+
+        //Now, we add the edge.
+        edgeSrcList[edge->getSrcID()].push_back(edge);
+        edgeDstList[edge->getDstID()].push_back(edge);
+    }
+}
+
 /**
  * Removes a node from the graph.
  * @param node The node to remove.
@@ -229,14 +282,40 @@ vector<ClangEdge*> TAGraph::getEdges(){
     return edges;
 }
 
+/**
+ * Gets the number of nodes in the graph.
+ * @return The number of nodes.
+ */
+int TAGraph::getNumNodes(){
+    int numNodes = 0;
+    for (auto it = nodeList.begin(); it != nodeList.end(); it++)
+        if (it->second != nullptr) numNodes++;
+
+    return numNodes;
+}
+
+/**
+ * Gets the number of edges in the graph.
+ * @return The number of edges.
+ */
+int TAGraph::getNumEdges(){
+    int numEdges = 0;
+    for (auto it = edgeSrcList.begin(); it != edgeSrcList.end(); it++)
+        numEdges += (int) it->second.size();
+
+    return numEdges;
+}
+
 /**
  * Finds a node by a given ID.
  * @param ID The ID of the node.
  * @return The node that was found.
  */
 ClangNode* TAGraph::findNodeByID(string ID) {
-    //We iterate through until we find the node.
-    return nodeList[ID];
+    //Looks up the node without inserting an empty entry.
+    auto it = nodeList.find(ID);
+    if (it == nodeList.end()) return nullptr;
+    return it->second;
 }
 
 /**
@@ -334,8 +413,8 @@ vector<ClangEdge*> TAGraph::findEdgesByDstID(ClangNode* dst){
  * @return Whether it exists or not.
  */
 bool TAGraph::nodeExists(string ID) {
-    if (nodeList[ID] == nullptr) return false;
-    return true;
+    auto it = nodeList.find(ID);
+    return it != nodeList.end() && it->second != nullptr;
 }
 
 /**
@@ -373,11 +452,28 @@ string TAGraph::generateTAFormat() {
     return format;
 }
 
+/**
+ * Writes the TA for this graph to a file on disk.
+ * @param fileName The file to write to.
+ * @return Whether the file was written.
+ */
+bool TAGraph::writeTAFormat(string fileName) {
+    ofstream taFile(fileName);
+    if (!taFile.is_open()) return false;
+
+    taFile << generateTAFormat();
+    taFile.close();
+
+    return true;
+}
+
 /**
  * Adds nodes in the graph to a file node.
  * @param fileSkip Whether we're going to skip a certain component.
  */
 void TAGraph::addNodesToFile(map<string, ClangNode*> fileSkip) {
+    vector<ClangEdge*> fileEdges;
+
     //Iterate through all our nodes and find the appropriate file.
     for (auto it = nodeList.begin(); it != nodeList.end(); it++) {
         ClangNode* node = it->second;
@@ -404,12 +500,14 @@ void TAGraph::addNodesToFile(map<string, ClangNode*> fileSkip) {
                     continue;
                 }
 
-                //Add it to the graph.
-                ClangEdge *edge = new ClangEdge(fileNode, node, ClangEdge::FILE_CONTAIN);
-                addEdge(edge);
+                //Add it to the batch.
+                fileEdges.push_back(new ClangEdge(fileNode, node, ClangEdge::FILE_CONTAIN));
             }
         }
     }
+
+    //Adds the edges to the graph.
+    addEdges(fileEdges);
 }
 
 /**
@@ -458,14 +556,15 @@ void TAGraph::resolveExternalReferences(Printer* print, bool silent) {
 /**
  * Resolves the file in the TA graph.
  * @param exclusions The TA exclusions.
+ * @param numThreads The number of threads that build the file tree.
  */
-void TAGraph::resolveFiles(TAGraph::ClangExclude exclusions){
+void TAGraph::resolveFiles(TAGraph::ClangExclude exclusions, int numThreads){
     bool assumeValid = true;
     vector<ClangNode*> fileNodes = vector<ClangNode*>();
     vector<ClangEdge*> fileEdges = vector<ClangEdge*>();
 
     //Gets all the associated clang nodes.
-    fileParser.processPaths(fileNodes, fileEdges);
+    fileParser.processPaths(fileNodes, fileEdges, numThreads);
 
     //Adds them to the graph.
     for (ClangNode *file : fileNodes) {
@@ -479,14 +578,16 @@ void TAGraph::resolveFiles(TAGraph::ClangExclude exclusions){
 
     //Adds the edges to the graph.
     map<string, ClangNode*> fileSkip;
+    vector<ClangEdge*> containEdges;
     for (ClangEdge *edge : fileEdges) {
         //Surpasses.
         if (exclusions.cFile && edge->getDst()->getType() == ClangNode::FILE){
             fileSkip[edge->getDst()->getID()] = edge->getSrc();
         } else {
-            addEdge(edge, assumeValid);
+            containEdges.push_back(edge);
         }
     }
+    addEdges(containEdges);
 
     //Next, for each item in the graph, add it to a file.
     addNodesToFile(fileSkip);
@@ -495,9 +596,167 @@ void TAGraph::resolveFiles(TAGraph::ClangExclude exclusions){
 /**
  * Adds a path to the TA graph.
  * @param path The path to process.
+ * @return Whether the path is new.
+ */
+bool TAGraph::addPath(string path){
+    return fileParser.addPath(path);
+}
+
+/**
+ * Gets the paths that were added to the TA graph.
+ * @return The list of paths.
  */
-void TAGraph::addPath(string path){
-    fileParser.addPath(path);
+vector<string> TAGraph::getPaths(){
+    return fileParser.getPaths();
+}
+
+/**
+ * Generates the facts in the graph as tab-separated lines. Edges are written by ID
+ * so references to nodes outside this graph are resolved wherever the facts are added.
+ * @return The facts.
+ */
+string TAGraph::generateFacts(){
+    string facts;
+    for (string curPath : getPaths()) facts += FACT_PATH + "\t" + escapeFact(curPath) + "\n";
+
+    //Writes each node followed by its attributes.
+    for (auto it = nodeList.begin(); it != nodeList.end(); it++){
+        ClangNode* node = it->second;
+        if (node == nullptr) continue;
+
+        facts += FACT_NODE + "\t" + escapeFact(node->getID()) + "\t" + to_string(node->getType()) + "\t" +
+                escapeFact(node->getName()) + "\n";
+        for (auto attribute : node->getAttributes()){
+            //The label is sent with the node.
+            if (attribute.first.compare("label") == 0) continue;
+            for (string value : attribute.second){
+                facts += FACT_ATTRIBUTE + "\t" + escapeFact(attribute.first) + "\t" + escapeFact(value) + "\n";
+            }
+        }
+    }
+
+    //Writes each edge followed by its attributes.
+    for (auto it = edgeSrcList.begin(); it != edgeSrcList.end(); it++){
+        for (ClangEdge* edge : it->second){
+            facts += FACT_EDGE + "\t" + escapeFact(edge->getSrcID()) + "\t" + escapeFact(edge->getDstID()) + "\t" +
+                    to_string(edge->getType()) + "\n";
+            for (auto attribute : edge->getAttributes()){
+                for (string value : attribute.second){
+                    facts += FACT_ATTRIBUTE + "\t" + escapeFact(attribute.first) + "\t" + escapeFact(value) + "\n";
+                }
+            }
+        }
+    }
+
+    return facts;
+}
+
+/**
+ * Adds facts generated by another graph. Nothing is added unless every fact is well formed.
+ * @param facts The facts to add.
+ * @return Whether the facts were well formed.
+ */
+bool TAGraph::addFacts(string facts){
+    vector<Fact> parsed;
+    if (!parseFacts(facts, &parsed)) return false;
+
+    applyFacts(parsed);
+    return true;
+}
+
+/**
+ * Parses facts generated by another graph without changing this graph.
+ * @param facts The facts to parse.
+ * @param parsed The parsed facts.
+ * @return Whether the facts were well formed.
+ */
+bool TAGraph::parseFacts(string facts, vector<Fact>* parsed){
+    size_t start = 0;
+    while (start < facts.size()){
+        size_t end = facts.find('\n', start);
+        if (end == string::npos) end = facts.size();
+        vector<string> fields = splitFact(facts.substr(start, end - start));
+        start = end + 1;
+        if (fields.size() == 0) continue;
+
+        //Attributes belong to the last node or edge.
+        if (fields.at(0).compare(FACT_ATTRIBUTE) == 0){
+            if (fields.size() != 3) return false;
+            if (parsed->size() > 0 && parsed->back().tag.compare(FACT_PATH) != 0){
+                parsed->back().attributes.push_back(make_pair(fields.at(1), fields.at(2)));
+            }
+            continue;
+        }
+
+        Fact fact;
+        fact.tag = fields.at(0);
+        fact.type = 0;
+        if (fact.tag.compare(FACT_PATH) == 0 && fields.size() == 2){
+            fact.fields = {fields.at(1)};
+        } else if (fact.tag.compare(FACT_NODE) == 0 && fields.size() == 4){
+            fact.fields = {fields.at(1), fields.at(3)};
+            try {
+                fact.type = stoi(fields.at(2));
+            } catch (...) {
+                return false;
+            }
+            if (fact.type < ClangNode::FILE || fact.type > ClangNode::ENUM_CONST) return false;
+        } else if (fact.tag.compare(FACT_EDGE) == 0 && fields.size() == 4){
+            fact.fields = {fields.at(1), fields.at(2)};
+            try {
+                fact.type = stoi(fields.at(3));
+            } catch (...) {
+                return false;
+            }
+            if (fact.type < ClangEdge::CALLS || fact.type > ClangEdge::FILE_CONTAIN) return false;
+        } else {
+            return false;
+        }
+        parsed->push_back(fact);
+    }
+
+    return true;
+}
+
+/**
+ * Adds parsed facts. Nodes and edges go through the same checks the walkers use,
+ * so nodes that already exist keep their attributes.
+ * @param parsed The parsed facts.
+ */
+void TAGraph::applyFacts(const vector<Fact>& parsed){
+    for (const Fact &fact : parsed){
+        if (fact.tag.compare(FACT_PATH) == 0){
+            addPath(fact.fields.at(0));
+        } else if (fact.tag.compare(FACT_NODE) == 0){
+            if (nodeExists(fact.fields.at(0))) continue;
+
+            //Nodes are added once all of their attributes are set.
+            ClangNode* node = new ClangNode(fact.fields.at(0), fact.fields.at(1), (ClangNode::NodeType) fact.type);
+            for (auto attribute : fact.attributes) node->addAttribute(attribute.first, attribute.second);
+            addNode(node, true);
+        } else {
+            string srcID = fact.fields.at(0);
+            string dstID = fact.fields.at(1);
+            ClangEdge::EdgeType type = (ClangEdge::EdgeType) fact.type;
+
+            //Links the edge to any nodes that are already here.
+            ClangNode* src = findNodeByID(srcID);
+            ClangNode* dst = findNodeByID(dstID);
+            ClangEdge* edge;
+            if (src && dst){
+                edge = new ClangEdge(src, dst, type);
+            } else if (!src && dst){
+                edge = new ClangEdge(srcID, dst, type);
+            } else if (src && !dst){
+                edge = new ClangEdge(src, dstID, type);
+            } else {
+                edge = new ClangEdge(srcID, dstID, type);
+            }
+            if (!addEdge(edge)) continue;
+
+            for (auto attribute : fact.attributes) addAttribute(srcID, dstID, type, attribute.first, attribute.second);
+        }
+    }
 }
 
 /**
@@ -600,3 +859,62 @@ string TAGraph::generateAttributes() {
 
     return attributes;
 }
+
+/**
+ * Escapes the backslashes, tabs and newlines in a fact.
+ * @param value The value to escape.
+ * @return The escaped value.
+ */
+string TAGraph::escapeFact(string value){
+    string escaped;
+    for (char cur : value){
+        if (cur == '\\') escaped += "\\\\";
+        else if (cur == '\t') escaped += "\\t";
+        else if (cur == '\n') escaped += "\\n";
+        else escaped += cur;
+    }
+
+    return escaped;
+}
+
+/**
+ * Reverses the escaping done by escapeFact.
+ * @param value The escaped value.
+ * @return The original value.
+ */
+string TAGraph::unescapeFact(string value){
+    string unescaped;
+    for (size_t i = 0; i < value.size(); i++){
+        if (value.at(i) != '\\' || i + 1 == value.size()){
+            unescaped += value.at(i);
+            continue;
+        }
+
+        char next = value.at(++i);
+        if (next == 't') unescaped += '\t';
+        else if (next == 'n') unescaped += '\n';
+        else unescaped += next;
+    }
+
+    return unescaped;
+}
+
+/**
+ * Splits a fact line on its tabs and unescapes each field.
+ * @param line The fact line.
+ * @return The fields in the line.
+ */
+vector<string> TAGraph::splitFact(string line){
+    vector<string> fields;
+    if (line.empty()) return fields;
+
+    size_t start = 0;
+    while (true){
+        size_t end = line.find('\t', start);
+        fields.push_back(unescapeFact(line.substr(start, (end == string::npos) ? string::npos : end - start)));
+        if (end == string::npos) break;
+        start = end + 1;
+    }
+
+    return fields;
+}
@@ -57,6 +57,7 @@ public:
     /** Node/Edge Adders */
     virtual bool addNode(ClangNode* node, bool assumeValid = false);
     virtual bool addEdge(ClangEdge* edge, bool assumeValid = false);
+    virtual void addEdges(std::vector<ClangEdge*> edges);
 
     /** Node/Edge Removers */
     void removeNode(ClangNode* node, bool unsafe = true);
@@ -70,6 +71,8 @@ public:
     /** Node/Edge Getters */
     std::vector<ClangNode*> getNodes();
     std::vector<ClangEdge*> getEdges();
+    virtual int getNumNodes();
+    virtual int getNumEdges();
 
     /** Find Operations */
     ClangNode* findNodeByID(std::string ID);
@@ -86,12 +89,26 @@ public:
 
     /** TA Operations */
     virtual std::string generateTAFormat();
+    virtual bool writeTAFormat(std::string fileName);
     virtual void addNodesToFile(std::map<std::string, ClangNode*> fileSkip);
 
+    /** Fact Streaming */
+    typedef struct {
+        std::string tag;
+        std::vector<std::string> fields;
+        int type;
+        std::vector<std::pair<std::string, std::string>> attributes;
+    } Fact;
+    std::string generateFacts();
+    bool parseFacts(std::string facts, std::vector<Fact>* parsed);
+    void applyFacts(const std::vector<Fact>& parsed);
+    bool addFacts(std::string facts);
+
     /** Unresolved Operations */
     virtual void resolveExternalReferences(Printer* print, bool silent = false);
-    virtual void resolveFiles(ClangExclude exclusions);
-    void addPath(std::string path);
+    virtual void resolveFiles(ClangExclude exclusions, int numThreads = 1);
+    virtual bool addPath(std::string path);
+    std::vector<std::string> getPaths();
 
     static const std::string FILE_ATTRIBUTE;
 
@@ -114,9 +131,20 @@ protected:
     std::string generateAttributes();
 
 private:
+    /** Fact Stream Tags */
+    std::string const FACT_NODE = "N";
+    std::string const FACT_EDGE = "E";
+    std::string const FACT_ATTRIBUTE = "A";
+    std::string const FACT_PATH = "P";
+
     /** Settings */
     FileParse fileParser;
 
+    /** Fact Stream Helpers */
+    std::string escapeFact(std::string value);
+    std::string unescapeFact(std::string value);
+    std::vector<std::string> splitFact(std::string line);
+
     /** TA Const Variables */
     std::string const TA_HEADER = "//Generated TA File";
     std::string const TA_SCHEMA = "//Author: Jingwei Wu & Bryan J Muscedere\n\nSCHEME TUPLE :\n//Nodes\n$INHERIT\tcArch"
@@ -99,6 +99,106 @@ void Printer::printResolveRefDone(int resolved, int unresolved) {
          << " references could not be resolved." << endl << endl;
 }
 
+/**
+ * Notifies that a previous run is being resumed.
+ * @param completed The number of files that were already completed.
+ */
+void Printer::printResumeRun(int completed) {
+    cout << "Resuming the previous run. " << completed << " file(s) were already completed and will be skipped."
+         << endl;
+}
+
+/**
+ * Notifies that a precompiled preamble will be used.
+ * @param numIncludes The number of includes in the preamble.
+ * @param numFiles The number of files parsed against it.
+ */
+void Printer::printPreamble(int numIncludes, int numFiles) {
+    cout << "Precompiled " << numIncludes << " shared include(s). " << numFiles
+         << " file(s) will be parsed against them." << endl;
+}
+
+/**
+ * Notifies how many translation units were loaded from the AST cache.
+ * @param hits The number of units loaded.
+ * @param misses The number of units parsed.
+ */
+void Printer::printASTCache(int hits, int misses) {
+    cout << hits << " translation unit(s) were loaded from the AST cache. " << misses << " were parsed." << endl;
+}
+
+/**
+ * Notifies how large a model is under the traversal policy.
+ * @param policy The traversal policy.
+ * @param numNodes The number of nodes extracted.
+ * @param numEdges The number of edges extracted.
+ */
+void Printer::printTraversal(std::string policy, int numNodes, int numEdges) {
+    cout << "The " << policy << " traversal extracted " << numNodes << " node(s) and " << numEdges
+         << " edge(s)." << endl;
+}
+
+/**
+ * Notifies how much file system work was shared between translation units.
+ * @param statHits The number of stats served from the cache.
+ * @param contentHits The number of file reads served from the cache.
+ */
+void Printer::printFileCache(int statHits, int contentHits) {
+    cout << statHits << " file stat(s) and " << contentHits << " file read(s) were served from the file cache."
+         << endl;
+}
+
+/**
+ * Notifies that the source tree is served from a snapshot.
+ * @param numFiles The number of files in the snapshot.
+ * @param built Whether the snapshot was built by this run.
+ */
+void Printer::printSnapshot(int numFiles, bool built) {
+    cout << ((built) ? "Built a snapshot of " : "Loaded a snapshot of ") << numFiles << " file(s)." << endl;
+}
+
+/**
+ * Notifies that a file was skipped because its worker didn't finish.
+ * @param fileName The file that was skipped.
+ * @param reason Why the worker didn't finish.
+ */
+void Printer::printWorkerFailure(std::string fileName, std::string reason) {
+    cout << "Skipping " << fileName << " because its worker " << reason << "." << endl;
+}
+
+/**
+ * Notifies how many files were skipped by isolated workers.
+ * @param numFiles The number of files skipped.
+ */
+void Printer::printWorkersSkipped(int numFiles) {
+    cout << numFiles << " file(s) were skipped because their worker crashed or timed out." << endl;
+}
+
+/**
+ * Notifies that low memory graphs are being compacted.
+ * @param numGraphs The number of graphs being compacted.
+ * @param numWorkers The number of workers compacting them.
+ */
+void Printer::printCompactStart(int numGraphs, int numWorkers) {
+    cout << "Compacting " << numGraphs << " graph(s) using " << numWorkers << " worker(s)..." << endl;
+}
+
+/**
+ * Notifies the result of compacting a single low memory graph.
+ * @param graphNum The number of the graph.
+ * @param success Whether the graph was compacted.
+ * @param resolved The number of references resolved.
+ * @param unresolved The number of references that could not be resolved.
+ */
+void Printer::printCompactDone(int graphNum, bool success, int resolved, int unresolved) {
+    if (success) {
+        cout << "\tGraph " << graphNum << ": " << resolved << " references were resolved and " << unresolved
+             << " references could not be resolved." << endl;
+    } else {
+        cout << "\tGraph " << graphNum << ": The graph could not be compacted." << endl;
+    }
+}
+
 /**
  * Method that notifies the user on a processing error.
  * @return The user's repsonse if they want to continue or not.
@@ -47,6 +47,16 @@ public:
     void printProcessStatus(Printer::PrintStatus status);
     bool printProcessFailure();
     void printResolveRefDone(int resolved, int unresolved);
+    void printResumeRun(int completed);
+    void printPreamble(int numIncludes, int numFiles);
+    void printASTCache(int hits, int misses);
+    void printTraversal(std::string policy, int numNodes, int numEdges);
+    void printFileCache(int statHits, int contentHits);
+    void printSnapshot(int numFiles, bool built);
+    void printWorkerFailure(std::string fileName, std::string reason);
+    void printWorkersSkipped(int numFiles);
+    void printCompactStart(int numGraphs, int numWorkers);
+    void printCompactDone(int graphNum, bool success, int resolved, int unresolved);
     
     /** Print Error Methods */
     void printErrorTAProcess(int lineNum, std::string message);
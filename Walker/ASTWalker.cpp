@@ -30,6 +30,7 @@
 #include <boost/filesystem.hpp>
 #include <openssl/md5.h>
 #include "ASTWalker.h"
+#include "ExtractAction.h"
 #include "clang/AST/Mangle.h"
 #include "../Graph/ClangNode.h"
 #include "../Graph/LowMemoryTAGraph.h"
@@ -53,6 +54,39 @@ TAGraph* ASTWalker::getGraph(){
     return graph;
 }
 
+/**
+ * Sets the filter that decides which declarations are in scope.
+ * @param filter The scope filter to use.
+ */
+void ASTWalker::setScopeFilter(ScopeFilter* filter){
+    scopeFilter = filter;
+}
+
+/**
+ * Restricts the walker to declarations. Calls and references are not matched.
+ * @param declsOnly Whether only declarations are extracted.
+ */
+void ASTWalker::setDeclsOnly(bool declsOnly){
+    this->declsOnly = declsOnly;
+}
+
+/**
+ * Sets whether the walker prints the files it processes. Only one walker
+ * prints when several share a parse.
+ * @param printFiles Whether file names are printed.
+ */
+void ASTWalker::setPrintFiles(bool printFiles){
+    this->printFiles = printFiles;
+}
+
+/**
+ * Whether the walker traverses the translation unit itself instead of using node matchers.
+ * @return False by default.
+ */
+bool ASTWalker::isSelfTraversing(){
+    return false;
+}
+
 /**
  * Generates an MD5 hash of the current string.
  * @param text The string to convert.
@@ -115,14 +149,22 @@ string ASTWalker::generateFileName(const MatchFinder::MatchResult result,
 
     if (Entry == nullptr) return string();
 
-    string fileName(Entry->getName());
+    //Checks if the file was already resolved in this translation unit.
+    string newPath;
+    auto cached = fileNameCache.find(Entry);
+    if (cached != fileNameCache.end()){
+        newPath = cached->second;
+    } else {
+        string fileName(Entry->getName());
 
-    //Use boost to get the absolute path.
-    boost::filesystem::path fN = boost::filesystem::path(fileName);
-    string newPath = canonical(fN.normalize()).string();
+        //Use boost to get the absolute path.
+        boost::filesystem::path fN = boost::filesystem::path(fileName);
+        newPath = canonical(fN.normalize()).string();
 
-    //Adds the file path.
-    graph->addPath(newPath);
+        //Adds the file path.
+        graph->addPath(newPath);
+        fileNameCache[Entry] = newPath;
+    }
 
     //Checks if we have a output suppression in place.
     if (!suppressFileOutput && newPath.compare("") != 0) printFileName(newPath);
@@ -136,9 +178,17 @@ string ASTWalker::generateFileName(const MatchFinder::MatchResult result,
  * @return The ID of the declaration.
  */
 string ASTWalker::generateID(const MatchFinder::MatchResult result, const NamedDecl *dec){
+    dec = collapseInstantiation(dec);
+
+    //Checks if the ID was already generated in this translation unit.
+    const Decl* canonDecl = dec->getCanonicalDecl();
+    auto it = idCache.find(canonDecl);
+    if (it != idCache.end()) return it->second;
+
     //Generates the ID.
     string name = generateIDString(result, dec);
     name = generateMD5(name);
+    idCache[canonDecl] = name;
     return name;
 }
 
@@ -149,6 +199,7 @@ string ASTWalker::generateID(const MatchFinder::MatchResult result, const NamedD
  * @return The generated string.
  */
 string ASTWalker::generateLabel(const MatchFinder::MatchResult result, const NamedDecl* curDecl) {
+    curDecl = collapseInstantiation(curDecl);
     string name = curDecl->getNameAsString();
     if (isa<RecordDecl>(curDecl) && (dyn_cast<RecordDecl>(curDecl)->isStruct()
                                  || dyn_cast<RecordDecl>(curDecl)->isUnion())
@@ -156,29 +207,17 @@ string ASTWalker::generateLabel(const MatchFinder::MatchResult result, const Nam
         name = ANON_REPLACE + "-" + generateLineNumber(result, curDecl->getSourceRange().getBegin());
     }
 
-    bool getParent = true;
     bool recurse = false;
     const NamedDecl *originalDecl = curDecl;
 
-    //Get the parent.
-    auto parent = result.Context->getParents(*curDecl);
-    while (getParent) {
-        //Check if it's empty.
-        if (parent.empty()) {
-            getParent = false;
-            continue;
-        }
-
-        //Get the current decl as named.
-        curDecl = parent[0].get<clang::NamedDecl>();
-        if (curDecl) {
-            name = generateLabel(result, curDecl) + "::" + name;
-            recurse = true;
-            getParent = false;
-            continue;
-        }
+    //Get the parent scope. Each scope is only named once per translation unit.
+    const NamedDecl *parentDecl = getNamedParent(curDecl);
+    if (parentDecl) {
+        auto it = labelPrefixes.find(parentDecl);
+        if (it == labelPrefixes.end()) it = labelPrefixes.emplace(parentDecl, generateLabel(result, parentDecl)).first;
 
-        parent = result.Context->getParents(parent[0]);
+        name = it->second + "::" + name;
+        recurse = true;
     }
 
     //Sees if no true qualified name was used.
@@ -209,6 +248,9 @@ string ASTWalker::generateLabel(const MatchFinder::MatchResult result, const Nam
  */
 bool ASTWalker::isInSystemHeader(const MatchFinder::MatchResult &result, const Decl *decl){
     if (decl == nullptr) return false;
+
+    //Traversed system headers are extracted like any other file.
+    if (scopeFilter != nullptr && !scopeFilter->prunesSystemHeaders()) return false;
     bool isIn;
 
     //Some system headers cause Clang to segfault.
@@ -231,6 +273,25 @@ bool ASTWalker::isInSystemHeader(const MatchFinder::MatchResult &result, const D
     return isIn;
 }
 
+/**
+ * Matches declarations outside of pruned system headers. Used on the top-level
+ * matchers so the inner matchers never run on system declarations.
+ * @return The declaration matcher.
+ */
+DeclarationMatcher ASTWalker::scopedDecl(){
+    if (scopeFilter != nullptr && scopeFilter->prunesSystemHeaders()) return decl(unless(isExpansionInSystemHeader()));
+    return decl();
+}
+
+/**
+ * Matches statements outside of pruned system headers.
+ * @return The statement matcher.
+ */
+StatementMatcher ASTWalker::scopedStmt(){
+    if (scopeFilter != nullptr && scopeFilter->prunesSystemHeaders()) return stmt(unless(isExpansionInSystemHeader()));
+    return stmt();
+}
+
 /**
  * Extracts the CXXRecordDecl from a NestedNameSpecifier.
  * @param name The NestedNameSpecifier
@@ -242,6 +303,180 @@ CXXRecordDecl* ASTWalker::extractClass(NestedNameSpecifier* name){
     return name->getAsType()->getAsCXXRecordDecl();
 }
 
+/**
+ * Resets the scope tracking for a new translation unit.
+ */
+void ASTWalker::onStartOfTranslationUnit(){
+    scopeStack.clear();
+    writeScope = nullptr;
+    writeRefs.clear();
+    fileNameCache.clear();
+    labelPrefixes.clear();
+    idPrefixes.clear();
+    typeSpellings.clear();
+    idCache.clear();
+    seenDecls.clear();
+}
+
+/**
+ * Adds the matcher that tracks the enclosing functions. Must be added before any
+ * matcher that needs the enclosing function of an expression.
+ * @param finder The match finder that will store these triggers.
+ */
+void ASTWalker::generateScopeMatches(MatchFinder *finder){
+    finder->addMatcher(functionDecl(scopedDecl()).bind(SCOPE_FUNC), this);
+}
+
+/**
+ * Updates the scope stack if the result is a scope match. Matches arrive in
+ * traversal order so every function that no longer contains the match is closed.
+ * @param result The match result.
+ * @return Whether the result was a scope match.
+ */
+bool ASTWalker::updateScope(const MatchFinder::MatchResult &result){
+    auto *scope = result.Nodes.getNodeAs<clang::FunctionDecl>(SCOPE_FUNC);
+    if (scope == nullptr) return false;
+
+    getEnclosingFunction(result, scope->getLocStart());
+    scopeStack.push_back(scope);
+    return true;
+}
+
+/**
+ * Gets the function that encloses an expression.
+ * @param result The match result.
+ * @param loc The location of the expression.
+ * @return The enclosing function or null if there is none.
+ */
+const FunctionDecl* ASTWalker::getEnclosingFunction(const MatchFinder::MatchResult &result, SourceLocation loc){
+    //Implicit code keeps the current scope.
+    if (loc.isValid()){
+        while (!scopeStack.empty() && !isInScope(result, scopeStack.back(), loc)) scopeStack.pop_back();
+    }
+
+    return (scopeStack.empty()) ? nullptr : scopeStack.back();
+}
+
+/**
+ * Gets the function a declaration is lexically inside of. Lambda bodies belong
+ * to the function the lambda is written in.
+ * @param decl The declaration.
+ * @return The parent function or null if there is none.
+ */
+const FunctionDecl* ASTWalker::getParentFunction(const Decl *decl){
+    for (const DeclContext *ctx = decl->getLexicalDeclContext(); ctx != nullptr; ctx = ctx->getLexicalParent()){
+        auto *function = dyn_cast<clang::FunctionDecl>(ctx);
+        if (function == nullptr) continue;
+
+        auto *method = dyn_cast<clang::CXXMethodDecl>(function);
+        if (method != nullptr && method->getParent()->isLambda()) continue;
+        return function;
+    }
+
+    return nullptr;
+}
+
+/**
+ * Maps a declaration inside a template instantiation to the same declaration in the
+ * primary template. Only done when the traversal policy collapses instantiations.
+ * @param decl The declaration.
+ * @return The declaration in the primary template or the declaration itself.
+ */
+const NamedDecl* ASTWalker::collapseInstantiation(const NamedDecl *decl){
+    if (scopeFilter == nullptr || !scopeFilter->collapsesInstantiations()) return decl;
+
+    if (auto *function = dyn_cast<clang::FunctionDecl>(decl)){
+        const FunctionDecl* pattern = function->getTemplateInstantiationPattern();
+        if (pattern != nullptr) return pattern;
+    } else if (auto *record = dyn_cast<clang::CXXRecordDecl>(decl)){
+        const CXXRecordDecl* pattern = record->getTemplateInstantiationPattern();
+        if (pattern != nullptr) return pattern;
+    } else if (auto *var = dyn_cast<clang::VarDecl>(decl)){
+        const VarDecl* pattern = var->getTemplateInstantiationPattern();
+        if (pattern != nullptr) return pattern;
+    } else if (auto *field = dyn_cast<clang::FieldDecl>(decl)){
+        //Fields are found by name in the pattern of their record.
+        auto *record = dyn_cast<clang::CXXRecordDecl>(field->getParent());
+        const CXXRecordDecl* pattern = (record != nullptr) ? record->getTemplateInstantiationPattern() : nullptr;
+        if (pattern != nullptr && field->getDeclName()){
+            for (auto *cur : pattern->lookup(field->getDeclName())){
+                if (isa<FieldDecl>(cur)) return cur;
+            }
+        }
+    }
+
+    return decl;
+}
+
+/**
+ * Checks whether a declaration is being added for the first time in this translation unit.
+ * @param decl The declaration.
+ * @return Whether the declaration is new.
+ */
+bool ASTWalker::isNewDecl(const Decl *decl){
+    return seenDecls.insert(decl->getCanonicalDecl()).second;
+}
+
+/**
+ * Forgets a declaration that couldn't be added so a later redeclaration can try again.
+ * @param decl The declaration.
+ */
+void ASTWalker::forgetDecl(const Decl *decl){
+    seenDecls.erase(decl->getCanonicalDecl());
+}
+
+/**
+ * Gets the closest named scope a declaration is lexically inside of. Lambda classes
+ * and their call operators are skipped since they don't contribute to names.
+ * @param decl The declaration.
+ * @return The parent scope or null if the declaration is at file scope.
+ */
+const NamedDecl* ASTWalker::getNamedParent(const Decl *decl){
+    for (const DeclContext *ctx = decl->getLexicalDeclContext(); ctx != nullptr; ctx = ctx->getLexicalParent()){
+        auto *named = dyn_cast<clang::NamedDecl>(ctx);
+        if (named == nullptr) continue;
+
+        auto *record = dyn_cast<clang::CXXRecordDecl>(ctx);
+        if (record != nullptr && record->isLambda()) continue;
+        auto *method = dyn_cast<clang::CXXMethodDecl>(ctx);
+        if (method != nullptr && method->getParent()->isLambda()) continue;
+        return named;
+    }
+
+    return nullptr;
+}
+
+/**
+ * Gets the closest class a declaration is lexically inside of.
+ * @param decl The declaration.
+ * @return The parent class or null if there is none.
+ */
+const CXXRecordDecl* ASTWalker::getParentClass(const Decl *decl){
+    for (const DeclContext *ctx = decl->getLexicalDeclContext(); ctx != nullptr; ctx = ctx->getLexicalParent()){
+        auto *record = dyn_cast<clang::CXXRecordDecl>(ctx);
+        if (record != nullptr && !record->isLambda()) return record;
+    }
+
+    return nullptr;
+}
+
+/**
+ * Gets the closest struct or union a declaration is lexically inside of.
+ * @param decl The declaration.
+ * @param unionRecord Whether to look for a union instead of a struct.
+ * @return The parent record or null if there is none.
+ */
+const RecordDecl* ASTWalker::getParentRecord(const Decl *decl, bool unionRecord){
+    for (const DeclContext *ctx = decl->getLexicalDeclContext(); ctx != nullptr; ctx = ctx->getLexicalParent()){
+        auto *record = dyn_cast<clang::RecordDecl>(ctx);
+        if (record == nullptr) continue;
+
+        if ((unionRecord) ? record->isUnion() : record->isStruct()) return record;
+    }
+
+    return nullptr;
+}
+
 /********************************************************************************************************************/
 // START AST TO GRAPH PARAMETERS
 /********************************************************************************************************************/
@@ -251,23 +486,28 @@ CXXRecordDecl* ASTWalker::extractClass(NestedNameSpecifier* name){
  * @param dec The function decl to add.
  */
 void ASTWalker::addFunctionDecl(const MatchFinder::MatchResult results, const FunctionDecl *dec) {
+    //Checks if the node was already added.
+    if (!isNewDecl(dec)) return;
+    string ID = generateID(results, dec);
+    if (ID.compare("") == 0){
+        forgetDecl(dec);
+        return;
+    }
+    if (graph->nodeExists(ID)) return;
+
     //Generate the fields for the node.
     string label = generateLabel(results, dec);
     string filename = generateFileName(results, dec->getInnerLocStart());
-    string ID = generateID(results, dec);
-    if (ID.compare("") == 0 || filename.compare("") == 0) return;
-
+    if (filename.compare("") == 0){
+        forgetDecl(dec);
+        return;
+    }
 
     //Creates a new function entry.
     ClangNode* node = new ClangNode(ID, label, ClangNode::FUNCTION);
-    bool succ = graph->addNode(node);
-    if (!succ) return;
 
     //Adds parameters.
-    graph->addAttribute(node->getID(),
-                                ClangNode::FILE_ATTRIBUTE.attrName,
-                                ClangNode::FILE_ATTRIBUTE.processFileName(filename));
-
+    node->addAttribute(ClangNode::FILE_ATTRIBUTE.attrName, ClangNode::FILE_ATTRIBUTE.processFileName(filename));
 
     //Check if we have a CXXMethodDecl.
     auto func = dec->getAsFunction();
@@ -283,22 +523,14 @@ void ASTWalker::addFunctionDecl(const MatchFinder::MatchResult results, const Fu
         AccessSpecifier spec = methDecl->getAccess();
 
         //Add these types of attributes.
-        graph->addAttribute(node->getID(),
-                                    ClangNode::FUNC_IS_ATTRIBUTE.staticName,
-                                    std::to_string(isStatic));
-        graph->addAttribute(node->getID(),
-                                    ClangNode::FUNC_IS_ATTRIBUTE.constName,
-                                    std::to_string(isConst));
-        graph->addAttribute(node->getID(),
-                                    ClangNode::FUNC_IS_ATTRIBUTE.volName,
-                                    std::to_string(isVol));
-        graph->addAttribute(node->getID(),
-                                    ClangNode::FUNC_IS_ATTRIBUTE.varName,
-                                    std::to_string(isVari));
-        graph->addAttribute(node->getID(),
-                                    ClangNode::VIS_ATTRIBUTE.attrName,
-                                    ClangNode::VIS_ATTRIBUTE.processAccessSpec(spec));
+        node->addAttribute(ClangNode::FUNC_IS_ATTRIBUTE.staticName, std::to_string(isStatic));
+        node->addAttribute(ClangNode::FUNC_IS_ATTRIBUTE.constName, std::to_string(isConst));
+        node->addAttribute(ClangNode::FUNC_IS_ATTRIBUTE.volName, std::to_string(isVol));
+        node->addAttribute(ClangNode::FUNC_IS_ATTRIBUTE.varName, std::to_string(isVari));
+        node->addAttribute(ClangNode::VIS_ATTRIBUTE.attrName, ClangNode::VIS_ATTRIBUTE.processAccessSpec(spec));
     }
+
+    graph->addNode(node, true);
 }
 
 /**
@@ -319,39 +551,44 @@ void ASTWalker::addVariableDecl(const MatchFinder::MatchResult results,
     bool useField = false;
     if (varDec == nullptr) useField = true;
 
+    //Checks if the node was already added.
+    const DeclaratorDecl* decl = (useField) ? static_cast<const DeclaratorDecl*>(fieldDec) : varDec;
+    if (!isNewDecl(decl)) return;
+    ID = generateID(results, decl);
+    if (ID.compare("") == 0){
+        forgetDecl(decl);
+        return;
+    }
+    if (graph->nodeExists(ID)) return;
+
     //Next, generate the fields for the decl.
     if (useField){
         label = generateLabel(results, fieldDec);
         filename = generateFileName(results, fieldDec->getInnerLocStart());
-        ID = generateID(results, fieldDec);
         scopeInfo = ClangNode::VAR_ATTRIBUTE.getScope(fieldDec);
         staticInfo = ClangNode::VAR_ATTRIBUTE.getStatic(fieldDec);
     } else {
         label = generateLabel(results, varDec);
         filename = generateFileName(results, varDec->getInnerLocStart());
-        ID = generateID(results, varDec);
         scopeInfo = ClangNode::VAR_ATTRIBUTE.getScope(varDec);
         staticInfo = ClangNode::VAR_ATTRIBUTE.getStatic(varDec);
     }
-    if (ID.compare("") == 0 || filename.compare("") == 0) return;
+    if (filename.compare("") == 0){
+        forgetDecl(decl);
+        return;
+    }
 
     //Creates a variable entry.
     ClangNode* node = new ClangNode(ID, label, ClangNode::VARIABLE);
-    bool succ = graph->addNode(node);
-    if (!succ) return;
 
     //Process attributes.
-    graph->addAttribute(node->getID(),
-                                ClangNode::FILE_ATTRIBUTE.attrName,
-                                ClangNode::FILE_ATTRIBUTE.processFileName(filename));
+    node->addAttribute(ClangNode::FILE_ATTRIBUTE.attrName, ClangNode::FILE_ATTRIBUTE.processFileName(filename));
 
     //Get the scope of the decl.
-    graph->addAttribute(node->getID(),
-                                ClangNode::VAR_ATTRIBUTE.scopeName,
-                                scopeInfo);
-    graph->addAttribute(node->getID(),
-                                ClangNode::VAR_ATTRIBUTE.staticName,
-                                staticInfo);
+    node->addAttribute(ClangNode::VAR_ATTRIBUTE.scopeName, scopeInfo);
+    node->addAttribute(ClangNode::VAR_ATTRIBUTE.staticName, staticInfo);
+
+    graph->addNode(node, true);
 }
 
 /**
@@ -368,32 +605,39 @@ void ASTWalker::addClassDecl(const MatchFinder::MatchResult results, const CXXRe
     //Check if we're dealing with a class.
     if (!classDecl->isClass()) return;
 
+    //Checks if the node was already added.
+    if (!isNewDecl(classDecl)) return;
+    string ID = generateID(results, classDecl);
+    if (ID.compare("") == 0){
+        forgetDecl(classDecl);
+        return;
+    }
+    if (graph->nodeExists(ID)) return;
+
     //Generate the fields for the node.
     string filename = (fName.compare("") == 0) ? generateFileName(results, classDecl->getInnerLocStart(), true) : fName;
-    string ID = generateID(results, classDecl);
     string className = generateLabel(results, classDecl);
-    if (ID.compare("") == 0 || filename.compare("") == 0) return;
+    if (filename.compare("") == 0){
+        forgetDecl(classDecl);
+        return;
+    }
 
     //Try to get the number of bases.
     int numBases = 0;
     try {
         numBases = classDecl->getNumBases();
     } catch (...){
+        forgetDecl(classDecl);
         return;
     }
 
     //Creates a class entry.
     ClangNode* node = new ClangNode(ID, className, ClangNode::CLASS);
-    bool succ = graph->addNode(node);
-    if (!succ) return;
 
     //Process attributes.
-    graph->addAttribute(node->getID(),
-                                ClangNode::FILE_ATTRIBUTE.attrName,
-                                ClangNode::FILE_ATTRIBUTE.processFileName(filename));
-    graph->addAttribute(node->getID(),
-                                ClangNode::BASE_ATTRIBUTE.attrName,
-                                std::to_string(numBases));
+    node->addAttribute(ClangNode::FILE_ATTRIBUTE.attrName, ClangNode::FILE_ATTRIBUTE.processFileName(filename));
+    node->addAttribute(ClangNode::BASE_ATTRIBUTE.attrName, std::to_string(numBases));
+    graph->addNode(node, true);
 
     //Get base classes.
     if (classDecl->getNumBases() > 0) {
@@ -415,22 +659,30 @@ void ASTWalker::addClassDecl(const MatchFinder::MatchResult results, const CXXRe
  * @param spoofFilename A potential false filename to add it under.
  */
 void ASTWalker::addEnumDecl(const MatchFinder::MatchResult result, const EnumDecl *enumDecl, string spoofFilename){
+    //Checks if the node was already added.
+    if (!isNewDecl(enumDecl)) return;
+    string ID = generateID(result, enumDecl);
+    if (ID.compare("") == 0){
+        forgetDecl(enumDecl);
+        return;
+    }
+    if (graph->nodeExists(ID)) return;
+
     //Generate the fields for the node.
     string filename = (spoofFilename.compare(string()) == 0) ?
                       generateFileName(result, enumDecl->getInnerLocStart()) : spoofFilename;
-    string ID = generateID(result, enumDecl);
     string enumName = generateLabel(result, enumDecl);
-    if (ID.compare("") == 0 || filename.compare("") == 0) return;
+    if (filename.compare("") == 0){
+        forgetDecl(enumDecl);
+        return;
+    }
 
     //Creates a enum entry.
     ClangNode* node = new ClangNode(ID, enumName, ClangNode::ENUM);
-    bool succ = graph->addNode(node);
-    if (!succ) return;
 
     //Process attributes.
-    graph->addAttribute(node->getID(),
-                                ClangNode::FILE_ATTRIBUTE.attrName,
-                                ClangNode::FILE_ATTRIBUTE.processFileName(filename));
+    node->addAttribute(ClangNode::FILE_ATTRIBUTE.attrName, ClangNode::FILE_ATTRIBUTE.processFileName(filename));
+    graph->addNode(node, true);
 }
 
 /**
@@ -441,22 +693,30 @@ void ASTWalker::addEnumDecl(const MatchFinder::MatchResult result, const EnumDec
  */
 void ASTWalker::addEnumConstantDecl(const MatchFinder::MatchResult result, const clang::EnumConstantDecl *enumDecl,
                                     string filenameSpoof){
+    //Checks if the node was already added.
+    if (!isNewDecl(enumDecl)) return;
+    string ID = generateID(result, enumDecl);
+    if (ID.compare("") == 0){
+        forgetDecl(enumDecl);
+        return;
+    }
+    if (graph->nodeExists(ID)) return;
+
     //Generate the fields for the node.
     string filename = (filenameSpoof.compare(string()) == 0) ?
                       generateFileName(result, enumDecl->getLocStart()) : filenameSpoof;
-    string ID = generateID(result, enumDecl);
     string enumName = generateLabel(result, enumDecl);
-    if (ID.compare("") == 0 || filename.compare("") == 0) return;
+    if (filename.compare("") == 0){
+        forgetDecl(enumDecl);
+        return;
+    }
 
     //Creates a new enum entry.
     ClangNode* node = new ClangNode(ID, enumName, ClangNode::ENUM_CONST);
-    bool succ = graph->addNode(node);
-    if (!succ) return;
 
     //Process attributes.
-    graph->addAttribute(node->getID(),
-                                ClangNode::FILE_ATTRIBUTE.attrName,
-                                ClangNode::FILE_ATTRIBUTE.processFileName(filename));
+    node->addAttribute(ClangNode::FILE_ATTRIBUTE.attrName, ClangNode::FILE_ATTRIBUTE.processFileName(filename));
+    graph->addNode(node, true);
 }
 
 /**
@@ -466,26 +726,26 @@ void ASTWalker::addEnumConstantDecl(const MatchFinder::MatchResult result, const
  * @param filename A spoof filename to add it under.
  */
 void ASTWalker::addStructDecl(const MatchFinder::MatchResult result, const clang::RecordDecl *structDecl, string filename){
+    //Checks if the node was already added.
+    if (!isNewDecl(structDecl)) return;
+    string ID = generateID(result, structDecl);
+    if (graph->nodeExists(ID)) return;
+
     //Checks whether the function is anonymous.
     bool isAnonymous = isAnonymousRecord(structDecl->getQualifiedNameAsString());
 
-    //With that, generates the ID, label, and filename.
+    //With that, generates the label and filename.
     string fileName = generateFileName(result, structDecl->getInnerLocStart());
-    string ID = generateID(result, structDecl);
     string label = generateLabel(result, structDecl);
 
     //Next, generates the node.
     ClangNode* node = new ClangNode(ID, label, ClangNode::STRUCT);
-    bool succ = graph->addNode(node);
-    if (!succ) return;
 
     //Process the attributes.
-    graph->addAttribute(node->getID(),
-                                ClangNode::FILE_ATTRIBUTE.attrName,
-                                ClangNode::FILE_ATTRIBUTE.processFileName(filename));
-    graph->addAttribute(node->getID(),
-                                ClangNode::STRUCT_ATTRIBUTE.anonymousName,
-                                ClangNode::STRUCT_ATTRIBUTE.processAnonymous(isAnonymous));
+    node->addAttribute(ClangNode::FILE_ATTRIBUTE.attrName, ClangNode::FILE_ATTRIBUTE.processFileName(filename));
+    node->addAttribute(ClangNode::STRUCT_ATTRIBUTE.anonymousName,
+                       ClangNode::STRUCT_ATTRIBUTE.processAnonymous(isAnonymous));
+    graph->addNode(node, true);
 }
 
 /**
@@ -495,26 +755,26 @@ void ASTWalker::addStructDecl(const MatchFinder::MatchResult result, const clang
  * @param filename A spoof filename to add it under.
  */
 void ASTWalker::addUnionDecl(const MatchFinder::MatchResult result, const RecordDecl *unionDecl, string filename){
+    //Checks if the node was already added.
+    if (!isNewDecl(unionDecl)) return;
+    string ID = generateID(result, unionDecl);
+    if (graph->nodeExists(ID)) return;
+
     //Checks whether the function is anonymous.
     bool isAnonymous = isAnonymousRecord(unionDecl->getQualifiedNameAsString());
 
-    //With that, generates the ID, label, and filename.
+    //With that, generates the label and filename.
     string fileName = generateFileName(result, unionDecl->getInnerLocStart());
-    string ID = generateID(result, unionDecl);
     string label = generateLabel(result, unionDecl);
 
     //Next, generates the node.
     ClangNode* node = new ClangNode(ID, label, ClangNode::UNION);
-    bool succ = graph->addNode(node);
-    if (!succ) return;
 
     //Process the attributes.
-    graph->addAttribute(node->getID(),
-                        ClangNode::FILE_ATTRIBUTE.attrName,
-                        ClangNode::FILE_ATTRIBUTE.processFileName(filename));
-    graph->addAttribute(node->getID(),
-                        ClangNode::STRUCT_ATTRIBUTE.anonymousName,
-                        ClangNode::STRUCT_ATTRIBUTE.processAnonymous(isAnonymous));
+    node->addAttribute(ClangNode::FILE_ATTRIBUTE.attrName, ClangNode::FILE_ATTRIBUTE.processFileName(filename));
+    node->addAttribute(ClangNode::STRUCT_ATTRIBUTE.anonymousName,
+                       ClangNode::STRUCT_ATTRIBUTE.processAnonymous(isAnonymous));
+    graph->addNode(node, true);
 }
 
 /**
@@ -538,16 +798,15 @@ void ASTWalker::addFunctionCall(const MatchFinder::MatchResult results, const De
  * Adds a variable call to the graph.
  * @param result The match result.
  * @param caller The caller.
- * @param expr The expression that the call takes place in.
+ * @param ref The reference to the variable.
  * @param varCallee The var callee.
  * @param fieldCallee The field callee.
  */
 void ASTWalker::addVariableCall(const MatchFinder::MatchResult result, const DeclaratorDecl *caller,
-                                const Expr* expr, const VarDecl *varCallee,
+                                const DeclRefExpr* ref, const VarDecl *varCallee,
                                 const FieldDecl *fieldCallee){
     string variableID;
     string variableLabel;
-    string variableShortName;
 
     //Generate the information associated with the caller.
     string callerID = generateID(result, caller);
@@ -557,17 +816,15 @@ void ASTWalker::addVariableCall(const MatchFinder::MatchResult result, const Dec
     if (fieldCallee == nullptr){
         variableID = generateID(result, varCallee);
         variableLabel = generateLabel(result, varCallee);
-        variableShortName = varCallee->getName();
     } else {
         variableID = generateID(result, fieldCallee);
         variableLabel = generateLabel(result, fieldCallee);
-        variableShortName = fieldCallee->getName();
     }
 
     //Generate the attributes.
     pair<string, string> accessVar = pair<string, string>();
     accessVar.first = ClangEdge::ACCESS_ATTRIBUTE.attrName;
-    accessVar.second = ClangEdge::ACCESS_ATTRIBUTE.getVariableAccess(expr, variableShortName);
+    accessVar.second = ClangEdge::ACCESS_ATTRIBUTE.getVariableAccess(isWrittenReference(caller, ref));
 
     vector<pair<string, string>> attributes = vector<pair<string, string>>();
     attributes.push_back(accessVar);
@@ -757,7 +1014,7 @@ void ASTWalker::processEdge(string srcID, string srcLabel, string dstID, string
  * @param curFile The current file being processed.
  */
 void ASTWalker::printFileName(string curFile){
-    if (curFile.compare(curFileName) != 0){
+    if (printFiles && curFile.compare(curFileName) != 0){
         //Ensure we're only outputting a source file.
         if (!isSource(curFile)) return;
 
@@ -780,9 +1037,9 @@ string ASTWalker::generateIDString(const MatchFinder::MatchResult result, const
     if (isa<FunctionDecl>(dec) || isa<CXXMethodDecl>(dec)){
         //Generates a special name for function overloading.
         const FunctionDecl* cur = dec->getAsFunction();
-        name = cur->getReturnType().getAsString() + "-" + dec->getNameAsString();
+        name = getTypeSpelling(cur->getReturnType()) + "-" + dec->getNameAsString();
         for (int i = 0; i < cur->getNumParams(); i++){
-            name += "-" + cur->parameters().data()[i]->getType().getAsString();
+            name += "-" + getTypeSpelling(cur->parameters().data()[i]->getType());
         }
     } else if (isa<RecordDecl>(dec) && (dyn_cast<RecordDecl>(dec)->isStruct() || dyn_cast<RecordDecl>(dec)->isUnion())) {
         //Generates a special name for structs and unions (especially anonymous ones).
@@ -798,29 +1055,17 @@ string ASTWalker::generateIDString(const MatchFinder::MatchResult result, const
     }
 
 
-    bool getParent = true;
     bool recurse = false;
     const NamedDecl* originalDecl = dec;
 
-    //Get the parent.
-    auto parent = result.Context->getParents(*dec);
-    while(getParent){
-        //Check if it's empty.
-        if (parent.empty()){
-            getParent = false;
-            continue;
-        }
+    //Get the parent scope. Each scope is only named once per translation unit.
+    const NamedDecl* parentDecl = getNamedParent(dec);
+    if (parentDecl) {
+        auto it = idPrefixes.find(parentDecl);
+        if (it == idPrefixes.end()) it = idPrefixes.emplace(parentDecl, generateIDString(result, parentDecl)).first;
 
-        //Get the current decl as named.
-        dec = parent[0].get<clang::NamedDecl>();
-        if (dec) {
-            name = generateIDString(result, dec) + "::" + name;
-            recurse = true;
-            getParent = false;
-            continue;
-        }
-
-        parent = result.Context->getParents(parent[0]);
+        name = it->second + "::" + name;
+        recurse = true;
     }
 
     //Sees if no true qualified name was used.
@@ -841,6 +1086,19 @@ string ASTWalker::generateIDString(const MatchFinder::MatchResult result, const
     return name;
 }
 
+/**
+ * Gets the spelling of a type. Spellings are cached per translation unit since
+ * printing template types is expensive and the same types show up in every ID.
+ * @param type The type to spell.
+ * @return The spelling of the type.
+ */
+const string& ASTWalker::getTypeSpelling(QualType type){
+    auto it = typeSpellings.find(type.getAsOpaquePtr());
+    if (it != typeSpellings.end()) return it->second;
+
+    return typeSpellings.emplace(type.getAsOpaquePtr(), type.getAsString()).first->second;
+}
+
 /**
  * Generates the line number for the current source location.
  * @param result The match result.
@@ -881,4 +1139,46 @@ bool ASTWalker::isAnonymousRecord(string qualName){
     }
 
     return false;
-}
\ No newline at end of file
+}
+
+/**
+ * Checks whether a variable reference is written to. The written references of the
+ * caller are collected once and reused for every reference inside of it.
+ * @param caller The function the reference is in.
+ * @param ref The variable reference.
+ * @return Whether the reference is written to.
+ */
+bool ASTWalker::isWrittenReference(const DeclaratorDecl *caller, const DeclRefExpr *ref){
+    auto *function = dyn_cast_or_null<clang::FunctionDecl>(caller);
+    if (function == nullptr || ref == nullptr) return false;
+
+    //Collects the writes for a new caller.
+    if (function != writeScope){
+        writeScope = function;
+        writeRefs.clear();
+
+        ClangEdge::ACCESS_ATTRIBUTE.collectWrites(function->getBody(), writeRefs);
+        if (auto *constructor = dyn_cast<clang::CXXConstructorDecl>(function)){
+            for (auto *init : constructor->inits()) ClangEdge::ACCESS_ATTRIBUTE.collectWrites(init->getInit(), writeRefs);
+        }
+    }
+
+    return writeRefs.find(ref) != writeRefs.end();
+}
+
+/**
+ * Checks whether a location is inside the source range of a function.
+ * @param result The match result.
+ * @param scope The function.
+ * @param loc The location to check.
+ * @return Whether the location is inside the function.
+ */
+bool ASTWalker::isInScope(const MatchFinder::MatchResult &result, const FunctionDecl *scope, SourceLocation loc){
+    auto &SourceManager = result.Context->getSourceManager();
+    SourceLocation begin = SourceManager.getExpansionLoc(scope->getLocStart());
+    SourceLocation end = SourceManager.getExpansionRange(scope->getLocEnd()).second;
+    SourceLocation cur = SourceManager.getExpansionLoc(loc);
+    if (begin.isInvalid() || end.isInvalid() || cur.isInvalid()) return false;
+
+    return !SourceManager.isBeforeInTranslationUnit(cur, begin) && !SourceManager.isBeforeInTranslationUnit(end, cur);
+}
@@ -31,6 +31,8 @@
 #include <vector>
 #include <tuple>
 #include <string>
+#include <unordered_set>
+#include <unordered_map>
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Tooling.h"
@@ -43,6 +45,8 @@
 
 using namespace clang::ast_matchers;
 
+class ScopeFilter;
+
 class ASTWalker : public MatchFinder::MatchCallback {
 public:
     /** Destructor */
@@ -52,15 +56,26 @@ public:
     virtual void run(const MatchFinder::MatchResult &result) = 0;
     virtual void generateASTMatches(MatchFinder *finder) = 0;
 
+    /** Translation Unit Hooks */
+    void onStartOfTranslationUnit() override;
+
     /** Graph Operations */
     TAGraph* getGraph();
 
+    /** Traversal Scope */
+    void setScopeFilter(ScopeFilter* filter);
+    void setDeclsOnly(bool declsOnly);
+    void setPrintFiles(bool printFiles);
+    virtual bool isSelfTraversing();
+
     /** MD5 Operations */
     static std::string generateMD5(std::string text);
 
 protected:
     /** Protected Variables */
     TAGraph::ClangExclude exclusions;
+    ScopeFilter* scopeFilter = nullptr;
+    bool declsOnly = false;
 
     /** Constructor */
     ASTWalker(TAGraph::ClangExclude ex, bool lowMemory, Printer* print, TAGraph* existing = nullptr);
@@ -73,8 +88,22 @@ protected:
 
     /** Protected Helper Methods */
     bool isInSystemHeader(const MatchFinder::MatchResult &result, const clang::Decl *decl);
+    DeclarationMatcher scopedDecl();
+    StatementMatcher scopedStmt();
     clang::CXXRecordDecl* extractClass(clang::NestedNameSpecifier* name);
 
+    /** Scope Tracking */
+    const char* SCOPE_FUNC = "scope_func";
+    void generateScopeMatches(MatchFinder *finder);
+    bool updateScope(const MatchFinder::MatchResult &result);
+    const clang::FunctionDecl* getEnclosingFunction(const MatchFinder::MatchResult &result, clang::SourceLocation loc);
+    const clang::FunctionDecl* getParentFunction(const clang::Decl *decl);
+    const clang::RecordDecl* getParentRecord(const clang::Decl *decl, bool unionRecord = false);
+    const clang::CXXRecordDecl* getParentClass(const clang::Decl *decl);
+
+    /** Access Tracking */
+    bool isWrittenReference(const clang::DeclaratorDecl *caller, const clang::DeclRefExpr *ref);
+
 /********************************************************************************************************************/
     /** Node Insertion Functions */
     void addFunctionDecl(const MatchFinder::MatchResult results, const clang::FunctionDecl *dec);
@@ -93,7 +122,8 @@ protected:
     void addFunctionCall(const MatchFinder::MatchResult results, const clang::DeclaratorDecl* caller,
                          const clang::FunctionDecl* callee);
     void addVariableCall(const MatchFinder::MatchResult result, const clang::DeclaratorDecl *caller,
-                         const clang::Expr* expr, const clang::VarDecl *varCallee, const clang::FieldDecl *fieldCallee = nullptr);
+                         const clang::DeclRefExpr* ref, const clang::VarDecl *varCallee,
+                         const clang::FieldDecl *fieldCallee = nullptr);
     void addVariableInsideCall(const MatchFinder::MatchResult result, const clang::FunctionDecl *functionParent,
                                const clang::VarDecl *varChild, const clang::FieldDecl *fieldChild = nullptr);
     void addClassCall(const MatchFinder::MatchResult result, const clang::CXXRecordDecl *classDecl, std::string declID,
@@ -120,8 +150,18 @@ private:
 
     /** Private Variables */
     std::string curFileName;
+    bool printFiles = true;
     TAGraph* graph;
     Printer *clangPrinter;
+    std::vector<const clang::FunctionDecl*> scopeStack;
+    const clang::FunctionDecl* writeScope = nullptr;
+    std::unordered_set<const clang::DeclRefExpr*> writeRefs;
+    std::unordered_map<const clang::FileEntry*, std::string> fileNameCache;
+    std::unordered_map<const clang::NamedDecl*, std::string> labelPrefixes;
+    std::unordered_map<const clang::NamedDecl*, std::string> idPrefixes;
+    std::unordered_map<void*, std::string> typeSpellings;
+    std::unordered_map<const clang::Decl*, std::string> idCache;
+    std::unordered_set<const clang::Decl*> seenDecls;
 
     /** Edge Processor */
     void processEdge(std::string srcID, std::string srcLabel, std::string dstID, std::string dstLabel,
@@ -131,9 +171,16 @@ private:
     /** Helper Methods */
     void printFileName(std::string curFile);
     std::string generateIDString(const MatchFinder::MatchResult result, const clang::NamedDecl* dec);
+    const clang::NamedDecl* collapseInstantiation(const clang::NamedDecl *decl);
+    bool isNewDecl(const clang::Decl *decl);
+    void forgetDecl(const clang::Decl *decl);
+    const clang::NamedDecl* getNamedParent(const clang::Decl *decl);
+    const std::string& getTypeSpelling(clang::QualType type);
     std::string generateLineNumber(const MatchFinder::MatchResult result, const SourceLocation loc);
     bool isSource(std::string fileName);
     bool isAnonymousRecord(std::string qualName);
+    bool isInScope(const MatchFinder::MatchResult &result, const clang::FunctionDecl *scope,
+                   clang::SourceLocation loc);
 };
 
 
@@ -48,6 +48,9 @@ BlobWalker::~BlobWalker(){ }
  * @param result The result that triggers this function.
  */
 void BlobWalker::run(const MatchFinder::MatchResult &result) {
+    //Tracks the enclosing functions.
+    if (updateScope(result)) return;
+
     //Check if the current result fits any of our match criteria.
     if (const FunctionDecl *functionDecl = result.Nodes.getNodeAs<clang::FunctionDecl>(types[FUNC_DEC])) {
         //Get whether we have a system header.
@@ -70,6 +73,10 @@ void BlobWalker::run(const MatchFinder::MatchResult &result) {
 
         //Adds a class reference.
         performAddClassCall(result, variableDecl, ClangNode::VARIABLE);
+
+        //Adds the scope of the variable.
+        auto *parentFunc = getParentFunction(variableDecl);
+        if (parentFunc != nullptr) addVariableInsideCall(result, parentFunc, variableDecl);
     } else if (const FieldDecl *fieldDecl = result.Nodes.getNodeAs<clang::FieldDecl>(types[FIELD_DEC])) {
         //Get whether we have a system header.
         if (isInSystemHeader(result, fieldDecl) || fieldDecl->getQualifiedNameAsString().compare("") == 0) return;
@@ -79,37 +86,15 @@ void BlobWalker::run(const MatchFinder::MatchResult &result) {
 
         //Adds a class reference.
         performAddClassCall(result, fieldDecl, ClangNode::VARIABLE);
-    } else if (const VarDecl *varInside = result.Nodes.getNodeAs<clang::VarDecl>(types[VAR_INSIDE])) {
-        //Get the parent function.
-        auto *parentFunc = result.Nodes.getNodeAs<clang::FunctionDecl>(types[INSIDE_FUNC]);
-
-        //Get whether this call expression is a system header.
-        if (isInSystemHeader(result, varInside) || varInside->getQualifiedNameAsString().compare("") == 0) return;
-
-        //Adds the function call.
-        addVariableInsideCall(result, parentFunc, varInside);
-    } else if (const FieldDecl *fieldInside = result.Nodes.getNodeAs<clang::FieldDecl>(types[FIELD_INSIDE])) {
-        //Get the parent function.
-        auto *parentFunc = result.Nodes.getNodeAs<clang::FunctionDecl>(types[INSIDE_FUNC]);
-
-        //Get whether this call expression is a system header.
-        if (isInSystemHeader(result, fieldInside) || fieldInside->getQualifiedNameAsString().compare("") == 0) return;
-
-        //Adds the function call.
-        addVariableInsideCall(result, parentFunc, nullptr, fieldInside);
-    } else if (const VarDecl *varParam = result.Nodes.getNodeAs<clang::VarDecl>(types[VAR_PARAM])) {
-        //Get the parent function.
-        auto *parentFunc = result.Nodes.getNodeAs<clang::FunctionDecl>(types[FUNC_PARAM]);
-
-        //Get whether this call expression is a system header.
-        if (isInSystemHeader(result, varParam) || varParam->getQualifiedNameAsString().compare("") == 0) return;
 
-        //Adds the function call.
-        addVariableInsideCall(result, parentFunc, varParam);
+        //Adds the scope of the field.
+        auto *parentFunc = getParentFunction(fieldDecl);
+        if (parentFunc != nullptr) addVariableInsideCall(result, parentFunc, nullptr, fieldDecl);
     } else if (const CallExpr *expr = result.Nodes.getNodeAs<clang::CallExpr>(types[FUNC_CALLEE])){
         if (expr->getCalleeDecl() == nullptr || !(isa<const clang::FunctionDecl>(expr->getCalleeDecl()))) return;
         auto callee = expr->getCalleeDecl()->getAsFunction();
-        auto caller = result.Nodes.getNodeAs<clang::DeclaratorDecl>(types[FUNC_CALLER]);
+        auto caller = getEnclosingFunction(result, expr->getLocStart());
+        if (caller == nullptr) return;
 
         //Get whether this call expression is a system header.
         if (isInSystemHeader(result, callee)) return;
@@ -117,22 +102,24 @@ void BlobWalker::run(const MatchFinder::MatchResult &result) {
         addFunctionCall(result, caller, callee);
     } else if (const VarDecl *callee = result.Nodes.getNodeAs<clang::VarDecl>(types[VAR_CALLEE])) {
         //If a variable reference has been found.
-        auto *caller = result.Nodes.getNodeAs<clang::DeclaratorDecl>(types[VAR_CALLER]);
-        auto *expr = result.Nodes.getNodeAs<clang::Expr>(types[VAR_EXPR]);
+        auto *ref = result.Nodes.getNodeAs<clang::DeclRefExpr>(types[VAR_REF]);
+        auto *caller = getEnclosingFunction(result, ref->getLocStart());
+        if (caller == nullptr) return;
 
         //Get whether this call expression is in the system header.
         if (isInSystemHeader(result, callee)) return;
 
-        addVariableCall(result, caller, expr, callee);
+        addVariableCall(result, caller, ref, callee);
     } else if (const FieldDecl *callee = result.Nodes.getNodeAs<clang::FieldDecl>(types[FIELD_CALLEE])){
         //If a variable reference has been found.
-        auto *caller = result.Nodes.getNodeAs<clang::DeclaratorDecl>(types[VAR_CALLER]);
-        auto *expr = result.Nodes.getNodeAs<clang::Expr>(types[VAR_EXPR]);
+        auto *ref = result.Nodes.getNodeAs<clang::DeclRefExpr>(types[VAR_REF]);
+        auto *caller = getEnclosingFunction(result, ref->getLocStart());
+        if (caller == nullptr) return;
 
         //Get whether this call expression is in the system header.
         if (isInSystemHeader(result, callee)) return;
 
-        addVariableCall(result, caller, expr, nullptr, callee);
+        addVariableCall(result, caller, ref, nullptr, callee);
     } else if (const CXXRecordDecl *classRec = result.Nodes.getNodeAs<clang::CXXRecordDecl>(types[CLASS_DEC])){
         //Get whether this call expression is in the system header.
         if (isInSystemHeader(result, classRec)) return;
@@ -151,7 +138,7 @@ void BlobWalker::run(const MatchFinder::MatchResult &result) {
         //Adds the enum constant declarations.
         addEnumConstantDecl(result, enumConstDecl);
 
-        auto *parent = result.Nodes.getNodeAs<clang::EnumDecl>(types[ENUM_PARENT]);
+        auto *parent = dyn_cast<clang::EnumDecl>(enumConstDecl->getDeclContext());
         if (parent == nullptr) return;
 
         addEnumConstantCall(result, parent, enumConstDecl);
@@ -176,7 +163,8 @@ void BlobWalker::run(const MatchFinder::MatchResult &result) {
         addStructDecl(result, structDecl);
     } else if (const DeclaratorDecl *itemDecl = result.Nodes.getNodeAs<clang::DeclaratorDecl>(types[STRUCT_REF_ITEM])){
         //Get the struct being referenced.
-        auto *structDecl = result.Nodes.getNodeAs<clang::RecordDecl>(types[STRUCT_REF]);
+        auto *structDecl = getParentRecord(itemDecl);
+        if (structDecl == nullptr) return;
 
         //Checks if the expression is in the system header.
         if (isInSystemHeader(result, itemDecl) || isInSystemHeader(result, structDecl)) return;
@@ -203,14 +191,6 @@ void BlobWalker::run(const MatchFinder::MatchResult &result) {
         if (isInSystemHeader(result, unionDecl)) return;
 
         addUnionDecl(result, unionDecl);
-    } else if (const DeclaratorDecl *itemDecl = result.Nodes.getNodeAs<clang::DeclaratorDecl>(types[STRUCT_REF_ITEM])){
-        //Get the union being referenced.
-        auto *unionDecl = result.Nodes.getNodeAs<clang::RecordDecl>(types[UNION_REF]);
-
-        //Checks if the expression is in the system header.
-        if (isInSystemHeader(result, itemDecl) || isInSystemHeader(result, unionDecl)) return;
-
-        addRecordCall(result, unionDecl, itemDecl);
     } else if (const VarDecl *varStruct = result.Nodes.getNodeAs<clang::VarDecl>(types[VAR_BOUND_UNION])){
         //Get the struct being referenced.
         auto *unionDecl = result.Nodes.getNodeAs<clang::RecordDecl>(types[UNION_REF_DECL]);
@@ -235,95 +215,88 @@ void BlobWalker::run(const MatchFinder::MatchResult &result) {
  * @param finder The match finder that will store these triggers.
  */
 void BlobWalker::generateASTMatches(MatchFinder *finder){
+    //Skips system headers before any inner matcher runs.
+    DeclarationMatcher inScope = scopedDecl();
+    StatementMatcher inScopeStmt = scopedStmt();
+
+    //Tracks the enclosing functions.
+    if (!declsOnly && (!exclusions.cFunction || !exclusions.cVariable)) generateScopeMatches(finder);
+
     //Function methods.
     if (!exclusions.cFunction){
         //Finds function declarations for current C/C++ file.
-        finder->addMatcher(functionDecl(isDefinition()).bind(types[FUNC_DEC]), this);
+        finder->addMatcher(functionDecl(isDefinition(), inScope).bind(types[FUNC_DEC]), this);
 
         //Finds function calls from one function to another.
-        finder->addMatcher(callExpr(hasAncestor(functionDecl().bind(types[FUNC_CALLER]))).bind(types[FUNC_CALLEE]), this);
+        if (!declsOnly) finder->addMatcher(callExpr(inScopeStmt).bind(types[FUNC_CALLEE]), this);
     }
 
     //Variable methods.
     if (!exclusions.cVariable){
         //Finds variable declarations in functions AND in class decs.
-        finder->addMatcher(varDecl().bind(types[VAR_DEC]), this);
-        finder->addMatcher(fieldDecl().bind(types[FIELD_DEC]), this);
-
-        //Adds scope for variables.
-        finder->addMatcher(varDecl(hasAncestor(functionDecl().bind(types[INSIDE_FUNC]))).bind(types[VAR_INSIDE]), this);
-        finder->addMatcher(fieldDecl(hasAncestor(functionDecl().bind(types[INSIDE_FUNC]))).bind(types[FIELD_INSIDE]), this);
-        finder->addMatcher(parmVarDecl(hasAncestor(functionDecl()
-                                                           .bind(types[FUNC_PARAM]))).bind(types[VAR_PARAM]), this);
-        
+        finder->addMatcher(varDecl(inScope).bind(types[VAR_DEC]), this);
+        finder->addMatcher(fieldDecl(inScope).bind(types[FIELD_DEC]), this);
+
         //Finds variable uses amongst functions.
-        finder->addMatcher(declRefExpr(hasDeclaration(varDecl().bind(types[VAR_CALLEE])),
-                           hasAncestor(functionDecl().bind(types[VAR_CALLER])),
-                           hasParent(expr().bind(types[VAR_EXPR]))), this);
-        finder->addMatcher(declRefExpr(hasDeclaration(fieldDecl().bind(types[FIELD_CALLEE])),
-                                       hasAncestor(functionDecl().bind(types[VAR_CALLER])),
-                                       hasParent(expr().bind(types[FIELD_EXPR]))), this);
+        if (!declsOnly){
+            finder->addMatcher(declRefExpr(inScopeStmt, hasDeclaration(varDecl().bind(types[VAR_CALLEE])))
+                                       .bind(types[VAR_REF]), this);
+            finder->addMatcher(declRefExpr(inScopeStmt, hasDeclaration(fieldDecl().bind(types[FIELD_CALLEE])))
+                                       .bind(types[VAR_REF]), this);
+        }
     }
 
     //Class methods.
     if (!exclusions.cClass){
         //Finds class declarations.
-        finder->addMatcher(cxxRecordDecl(isClass()).bind(types[CLASS_DEC]), this);
+        finder->addMatcher(cxxRecordDecl(isClass(), inScope).bind(types[CLASS_DEC]), this);
     }
 
     //Enum methods.
     if (!exclusions.cEnum){
         //Finds enum declarations.
-        finder->addMatcher(enumDecl().bind(types[ENUM_DEC]), this);
+        finder->addMatcher(enumDecl(inScope).bind(types[ENUM_DEC]), this);
 
         //Finds enum constant declarations.
         //Also deals with their connections to enums.
-        finder->addMatcher(enumConstantDecl().bind(types[ENUM_CONST_DECL]), this);
-        finder->addMatcher(enumConstantDecl(hasAncestor(enumDecl().bind(types[ENUM_PARENT])))
-                .bind(types[ENUM_CONST_DECL]), this);
+        finder->addMatcher(enumConstantDecl(inScope).bind(types[ENUM_CONST_DECL]), this);
 
         //Looks for enum references.
-        finder->addMatcher(varDecl(hasType(enumDecl().bind(types[ENUM_DEC_REF]))).bind(types[VAR_REF_ENUM]), this);
-        finder->addMatcher(fieldDecl(hasType(enumDecl().bind(types[ENUM_DEC_REF]))).bind(types[FIELD_REF_ENUM]), this);
+        finder->addMatcher(varDecl(inScope, hasType(enumDecl().bind(types[ENUM_DEC_REF]))).bind(types[VAR_REF_ENUM]), this);
+        finder->addMatcher(fieldDecl(inScope, hasType(enumDecl().bind(types[ENUM_DEC_REF])))
+                                   .bind(types[FIELD_REF_ENUM]), this);
     }
 
     //Struct methods.
     if (!exclusions.cStruct){
         //Builds the struct definition.
-        finder->addMatcher(recordDecl(isStruct()).bind(types[STRUCT_DECL]), this);
+        finder->addMatcher(recordDecl(isStruct(), inScope).bind(types[STRUCT_DECL]), this);
 
         //Builds up struct.
-        finder->addMatcher(varDecl(hasAncestor(recordDecl(isStruct()).bind(types[STRUCT_REF])))
-                                   .bind(types[STRUCT_REF_ITEM]), this);
-        finder->addMatcher(fieldDecl(hasAncestor(recordDecl(isStruct()).bind(types[STRUCT_REF])))
-                                   .bind(types[STRUCT_REF_ITEM]), this);
-        finder->addMatcher(functionDecl(hasAncestor(recordDecl(isStruct()).bind(types[STRUCT_REF])))
-                                   .bind(types[STRUCT_REF_ITEM]), this);
+        finder->addMatcher(varDecl(inScope).bind(types[STRUCT_REF_ITEM]), this);
+        finder->addMatcher(fieldDecl(inScope).bind(types[STRUCT_REF_ITEM]), this);
+        finder->addMatcher(functionDecl(inScope).bind(types[STRUCT_REF_ITEM]), this);
 
         //Builds the struct reference.
-        finder->addMatcher(varDecl(hasType(elaboratedType(namesType(recordType(hasDeclaration(recordDecl(isStruct())
+        finder->addMatcher(varDecl(inScope,
+                                   hasType(elaboratedType(namesType(recordType(hasDeclaration(recordDecl(isStruct())
                            .bind(types[STRUCT_REF_DECL]))))))).bind(types[VAR_BOUND_STRUCT]), this);
-        finder->addMatcher(fieldDecl(hasType(elaboratedType(namesType(recordType(hasDeclaration(recordDecl(isStruct())
+        finder->addMatcher(fieldDecl(inScope,
+                                   hasType(elaboratedType(namesType(recordType(hasDeclaration(recordDecl(isStruct())
                            .bind(types[STRUCT_REF_DECL]))))))).bind(types[FIELD_BOUND_STRUCT]), this);
     }
 
     //Union methods.
     if (!exclusions.cUnion){
         //Builds the union definition.
-        finder->addMatcher(recordDecl(isUnion()).bind(types[UNION_DECL]), this);
-
-        //Builds up union.
-        finder->addMatcher(varDecl(hasAncestor(recordDecl(isUnion()).bind(types[UNION_REF])))
-                                   .bind(types[UNION_REF_ITEM]), this);
-        finder->addMatcher(fieldDecl(hasAncestor(recordDecl(isUnion()).bind(types[UNION_REF])))
-                                   .bind(types[UNION_REF_ITEM]), this);
-        finder->addMatcher(functionDecl(hasAncestor(recordDecl(isUnion()).bind(types[UNION_REF])))
-                                   .bind(types[UNION_REF_ITEM]), this);
+        finder->addMatcher(recordDecl(isUnion(), inScope).bind(types[UNION_DECL]), this);
 
         //Builds the struct reference.
-        finder->addMatcher(varDecl(hasType(elaboratedType(namesType(recordType(hasDeclaration(recordDecl(isUnion())
+        finder->addMatcher(varDecl(inScope,
+                                   hasType(elaboratedType(namesType(recordType(hasDeclaration(recordDecl(isUnion())
                            .bind(types[UNION_REF_DECL]))))))).bind(types[VAR_BOUND_UNION]), this);
-        finder->addMatcher(fieldDecl(hasType(elaboratedType(namesType(recordType(hasDeclaration(recordDecl(isUnion())
+        finder->addMatcher(fieldDecl(inScope,
+                                   hasType(elaboratedType(namesType(recordType(hasDeclaration(recordDecl(isUnion())
                            .bind(types[UNION_REF_DECL]))))))).bind(types[FIELD_BOUND_UNION]), this);
     }
 }
@@ -341,28 +314,11 @@ void BlobWalker::performAddClassCall(const MatchFinder::MatchResult result, cons
         string declID = generateID(result, decl);
         string declLabel = generateLabel(result, decl);
 
-        //Use the manual walker system.
-        bool getParent = true;
-        const CXXRecordDecl* classDecl;
-
-        //Get the parent.
-        auto parent = result.Context->getParents(*decl);
-        while (getParent) {
-            //Check if it's empty.
-            if (parent.empty()) {
-                getParent = false;
-                continue;
-            }
-
-            //Get the current decl as named.
-            classDecl = parent[0].get<clang::CXXRecordDecl>();
-            if (classDecl) {
-                addClassCall(result, classDecl, declID, declLabel);
-                return;
-
-            }
-
-            parent = result.Context->getParents(parent[0]);
+        //Get the enclosing class.
+        const CXXRecordDecl* classDecl = getParentClass(decl);
+        if (classDecl) {
+            addClassCall(result, classDecl, declID, declLabel);
+            return;
         }
 
         //Checks if we can add a class reference (secondary attempt).
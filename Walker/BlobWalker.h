@@ -44,18 +44,16 @@ public:
 
 private:
     /** Enum and Array for AST Matcher */
-    enum {FUNC_DEC = 0, VAR_DEC, FIELD_DEC, VAR_INSIDE, FIELD_INSIDE, INSIDE_FUNC, VAR_PARAM, FUNC_PARAM,
-        FUNC_CALLER, FUNC_CALLEE, VAR_CALLER, VAR_CALLEE, VAR_EXPR,
-        FIELD_CALLEE, FIELD_EXPR, CLASS_DEC, ENUM_DEC, ENUM_CONST_DECL, ENUM_PARENT, ENUM_DEC_REF, VAR_REF_ENUM,
-        FIELD_REF_ENUM, STRUCT_DECL, STRUCT_REF_ITEM, STRUCT_REF, STRUCT_REF_DECL, VAR_BOUND_STRUCT, FIELD_BOUND_STRUCT,
-        UNION_DECL, UNION_REF_ITEM, UNION_REF, UNION_REF_DECL, VAR_BOUND_UNION, FIELD_BOUND_UNION};
-    const char* types[34] = {"func_dec", "var_dec", "field_dec", "var_inside", "field_inside", "inside_func",
-                             "var_param", "func_param", "caller", "callee", "v_caller", "v_callee", "v_expr",
-                            "field_callee", "field_expr", "class_dec", "enum_dec", "enum_const_decl", "enum_parent",
-                            "enum_dec_ref", "var_ref_enum", "field_ref_enum", "struct_decl", "struct_ref_item",
-                            "struct_ref", "struct_ref_decl", "var_bound_struct", "field_bound_struct", "union_decl",
-                             "union_ref_item", "union_ref", "union_ref_decl", "var_bound_union", "field_bound_union"};
-
+    enum {FUNC_DEC = 0, VAR_DEC, FIELD_DEC, FUNC_CALLEE, VAR_REF, VAR_CALLEE, FIELD_CALLEE, CLASS_DEC, ENUM_DEC,
+        ENUM_CONST_DECL, ENUM_DEC_REF, VAR_REF_ENUM, FIELD_REF_ENUM, STRUCT_DECL, STRUCT_REF_ITEM, STRUCT_REF_DECL,
+        VAR_BOUND_STRUCT, FIELD_BOUND_STRUCT, UNION_DECL, UNION_REF_DECL, VAR_BOUND_UNION, FIELD_BOUND_UNION};
+    const char* types[22] = {"func_dec", "var_dec", "field_dec", "callee", "v_ref", "v_callee", "field_callee",
+                             "class_dec", "enum_dec", "enum_const_decl", "enum_dec_ref", "var_ref_enum",
+                             "field_ref_enum", "struct_decl", "struct_ref_item", "struct_ref_decl",
+                             "var_bound_struct", "field_bound_struct", "union_decl", "union_ref_decl",
+                             "var_bound_union", "field_bound_union"};
+
+protected:
     /** Manages Classes */
     void performAddClassCall(const MatchFinder::MatchResult result, const clang::DeclaratorDecl *decl,
                              ClangNode::NodeType type);
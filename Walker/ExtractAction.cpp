@@ -0,0 +1,619 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ExtractAction.cpp
+//
+// Frontend action that runs the AST matchers over a translation unit.
+// Uses a scope filter to skip declarations in system headers, in files
+// outside the include/exclude globs, and in headers that were already
+// extracted by an earlier translation unit.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <fnmatch.h>
+#include <sstream>
+#include "ExtractAction.h"
+
+using namespace std;
+using namespace clang;
+using namespace clang::tooling;
+using namespace clang::ast_matchers;
+
+/**
+ * Checks whether a header was already extracted.
+ * @param key The header key.
+ * @return Whether the header was extracted.
+ */
+bool HeaderCache::contains(string key){
+    lock_guard<mutex> lock(cacheLock);
+    return extracted.find(key) != extracted.end();
+}
+
+/**
+ * Marks headers as extracted.
+ * @param keys The header keys.
+ */
+void HeaderCache::commit(vector<string> keys){
+    lock_guard<mutex> lock(cacheLock);
+    for (string key : keys){
+        if (extracted.insert(key).second && logging) log.push_back(key);
+    }
+}
+
+/**
+ * Gets the number of extracted headers.
+ * @return The number of headers.
+ */
+int HeaderCache::getNumHeaders(){
+    lock_guard<mutex> lock(cacheLock);
+    return (int) extracted.size();
+}
+
+/**
+ * Starts recording the headers that are committed. Used by isolated workers
+ * to hand their headers back to the parent.
+ */
+void HeaderCache::startLog(){
+    lock_guard<mutex> lock(cacheLock);
+    logging = true;
+    log.clear();
+}
+
+/**
+ * Gets the headers committed since the log was started.
+ * @return The header keys.
+ */
+vector<string> HeaderCache::getLog(){
+    lock_guard<mutex> lock(cacheLock);
+    return log;
+}
+
+/**
+ * Gets the content hash of a file. Hashes are reused while the size and modification time stay the same.
+ * @param manager The source manager for the translation unit.
+ * @param file The file to hash.
+ * @return The MD5 of the file contents.
+ */
+string HeaderCache::getContentHash(const SourceManager &manager, FileID file){
+    const FileEntry* entry = manager.getFileEntryForID(file);
+    if (entry == nullptr) return string();
+
+    string stamp = string(entry->getName()) + ":" + to_string(entry->getSize()) + ":" +
+            to_string(entry->getModificationTime());
+    {
+        lock_guard<mutex> lock(cacheLock);
+        auto cached = contentHashes.find(stamp);
+        if (cached != contentHashes.end()) return cached->second;
+    }
+
+    //Hashes the contents outside the lock.
+    bool invalid = false;
+    StringRef content = manager.getBufferData(file, &invalid);
+    if (invalid) return string();
+    string hash = ASTWalker::generateMD5(content.str());
+
+    lock_guard<mutex> lock(cacheLock);
+    contentHashes[stamp] = hash;
+    return hash;
+}
+
+/**
+ * Creates a scope filter.
+ * @param includeGlobs Files must match one of these globs. Empty matches all files.
+ * @param excludeGlobs Files must not match any of these globs.
+ * @param pruneSystemHeaders Whether system headers are skipped.
+ * @param cache The cache of extracted headers. Null disables the cache.
+ * @param traversal How template instantiations and implicit code are traversed.
+ */
+ScopeFilter::ScopeFilter(vector<string> includeGlobs, vector<string> excludeGlobs, bool pruneSystemHeaders,
+                         HeaderCache* cache, ClangDriver::TraversalPolicy traversal) :
+        includeGlobs(includeGlobs), excludeGlobs(excludeGlobs), pruneSystemHeaders(pruneSystemHeaders),
+        traversal(traversal), cache(cache) { }
+
+/**
+ * Checks whether the filter prunes anything that a single matchAST pass can't skip.
+ * System headers alone don't count since the walkers' matchers already reject them
+ * and matching node by node costs more than one pass over the whole unit.
+ * @return Whether the filter is active.
+ */
+bool ScopeFilter::isActive(){
+    return includeGlobs.size() > 0 || excludeGlobs.size() > 0 || cache != nullptr || traversal != ClangDriver::FULL;
+}
+
+/**
+ * Checks whether template instantiations are traversed.
+ * @return Whether instantiations are visited.
+ */
+bool ScopeFilter::visitsInstantiations() const {
+    return traversal == ClangDriver::FULL;
+}
+
+/**
+ * Checks whether compiler-generated code is traversed.
+ * @return Whether implicit code is visited.
+ */
+bool ScopeFilter::visitsImplicitCode() const {
+    return traversal == ClangDriver::FULL;
+}
+
+/**
+ * Checks whether declarations in system headers are skipped.
+ * @return Whether system headers are pruned.
+ */
+bool ScopeFilter::prunesSystemHeaders() const {
+    return pruneSystemHeaders;
+}
+
+/**
+ * Checks whether references to instantiations are named after their primary template.
+ * @return Whether instantiations are collapsed.
+ */
+bool ScopeFilter::collapsesInstantiations() const {
+    return traversal == ClangDriver::COLLAPSED;
+}
+
+/**
+ * Prepares the filter for a new translation unit. File IDs are only valid for one unit.
+ * Headers are only looked up in the cache when the macros they use can be recorded.
+ * @param preprocessor The preprocessor for the unit.
+ * @param preprocessing Whether the unit is about to be preprocessed. False for loaded ASTs.
+ */
+void ScopeFilter::beginTranslationUnit(Preprocessor &preprocessor, bool preprocessing){
+    fileScope.clear();
+    pendingHeaders.clear();
+    macroUses.clear();
+    recordingMacros = false;
+    if (cache == nullptr || !preprocessing) return;
+
+    headerSearch = &preprocessor.getHeaderSearchInfo();
+    preprocessorState = generatePreprocessorState(preprocessor);
+    preprocessor.addPPCallbacks(unique_ptr<PPCallbacks>(new HeaderMacroRecorder(this, preprocessor)));
+    recordingMacros = true;
+}
+
+/**
+ * Finishes a translation unit. Headers extracted by a clean unit are added to the cache.
+ * @param succeeded Whether the unit compiled without errors.
+ */
+void ScopeFilter::endTranslationUnit(bool succeeded){
+    if (cache != nullptr && succeeded) cache->commit(pendingHeaders);
+
+    pendingHeaders.clear();
+    macroUses.clear();
+    recordingMacros = false;
+    headerSearch = nullptr;
+}
+
+/**
+ * Records a macro that a file tests or expands. Conditions are kept in order
+ * while expansions are only kept once.
+ * @param manager The source manager for the translation unit.
+ * @param loc Where the macro was used.
+ * @param use The macro and its definition or the result of the condition.
+ * @param condition Whether the use is a conditional directive.
+ */
+void ScopeFilter::recordMacroUse(const SourceManager &manager, SourceLocation loc, string use, bool condition){
+    if (loc.isInvalid()) return;
+    SourceLocation expansion = manager.getExpansionLoc(loc);
+
+    //Only headers that could be cached need their macros.
+    FileID file = manager.getFileID(expansion);
+    if (file == manager.getMainFileID() || (pruneSystemHeaders && manager.isInSystemHeader(expansion))) return;
+
+    MacroUses &uses = macroUses[file.getHashValue()];
+    if (condition) uses.conditions += use + "\n";
+    else uses.expansions.insert(use);
+}
+
+/**
+ * Checks whether a declaration lives in a file that is in scope.
+ * Decisions are cached per file so each header is only checked once.
+ * @param manager The source manager for the translation unit.
+ * @param decl The declaration to check.
+ * @return Whether the declaration is in scope.
+ */
+bool ScopeFilter::isInScope(const SourceManager &manager, const Decl *decl){
+    if (decl == nullptr || isa<TranslationUnitDecl>(decl)) return true;
+
+    //Gets where this item is expanded.
+    SourceLocation loc = manager.getExpansionLoc(decl->getLocation());
+    if (loc.isInvalid()) return true;
+
+    FileScope scope = getFileScope(manager, manager.getFileID(loc), loc);
+    if (scope != EXTRACTED) return scope == IN_SCOPE;
+
+    //Extracted headers are still entered to reach template instantiations from this unit.
+    if (isa<NamespaceDecl>(decl) || isa<LinkageSpecDecl>(decl) || isa<TemplateDecl>(decl)) return true;
+    return isInstantiated(decl);
+}
+
+/**
+ * Gets the scope of a file. Headers that are in scope are looked up in the header cache.
+ * @param manager The source manager for the translation unit.
+ * @param file The file to check.
+ * @param loc A location in the file.
+ * @return The scope of the file.
+ */
+ScopeFilter::FileScope ScopeFilter::getFileScope(const SourceManager &manager, FileID file, SourceLocation loc){
+    auto cached = fileScope.find(file.getHashValue());
+    if (cached != fileScope.end()) return cached->second;
+
+    //The main file is always processed.
+    FileScope scope = IN_SCOPE;
+    const FileEntry* entry = manager.getFileEntryForID(file);
+    if (file != manager.getMainFileID()){
+        string fileName = (entry == nullptr) ? string() : string(entry->getName());
+        if (entry != nullptr && !entry->tryGetRealPathName().empty()) fileName = entry->tryGetRealPathName();
+
+        scope = (isFileInScope(fileName, manager.isInSystemHeader(loc))) ? IN_SCOPE : OUT_OF_SCOPE;
+
+        //Only guarded headers have the same facts wherever they are included.
+        if (scope == IN_SCOPE && cache != nullptr && recordingMacros && entry != nullptr && headerSearch != nullptr &&
+                headerSearch->isFileMultipleIncludeGuarded(entry)){
+            string key = fileName + "|" + cache->getContentHash(manager, file) + "|" + preprocessorState + "|" +
+                    generateMacroState(file);
+            if (cache->contains(key)) scope = EXTRACTED;
+            else pendingHeaders.push_back(key);
+        }
+    }
+
+    fileScope[file.getHashValue()] = scope;
+    return scope;
+}
+
+/**
+ * Generates a digest of the preprocessor state that headers are parsed under.
+ * @param preprocessor The preprocessor for the unit.
+ * @return The digest of the state.
+ */
+string ScopeFilter::generatePreprocessorState(Preprocessor &preprocessor){
+    stringstream state;
+
+    //Macros and forced includes from the command line.
+    for (auto macro : preprocessor.getPreprocessorOpts().Macros){
+        state << ((macro.second) ? "-U" : "-D") << macro.first << "\n";
+    }
+    for (string include : preprocessor.getPreprocessorOpts().Includes) state << "-include" << include << "\n";
+
+    //Header search paths.
+    for (auto entry : preprocessor.getHeaderSearchInfo().getHeaderSearchOpts().UserEntries){
+        state << "-I" << entry.Path << "\n";
+    }
+
+    //Target and language.
+    const LangOptions &lang = preprocessor.getLangOpts();
+    state << preprocessor.getTargetInfo().getTriple().str() << "\n"
+          << lang.CPlusPlus << lang.CPlusPlus11 << lang.CPlusPlus14 << lang.CPlusPlus17
+          << lang.C99 << lang.C11 << lang.GNUMode << lang.ObjC1;
+
+    return ASTWalker::generateMD5(state.str());
+}
+
+/**
+ * Generates a digest of the macros a header tested and expanded. Headers included
+ * under different macro definitions get different digests.
+ * @param file The header.
+ * @return The digest of the macros.
+ */
+string ScopeFilter::generateMacroState(FileID file){
+    auto found = macroUses.find(file.getHashValue());
+    if (found == macroUses.end()) return ASTWalker::generateMD5(string());
+
+    stringstream state;
+    state << found->second.conditions;
+    for (string expansion : found->second.expansions) state << expansion << "\n";
+    return ASTWalker::generateMD5(state.str());
+}
+
+/**
+ * Checks whether a declaration comes from a template instantiation.
+ * These depend on the unit that triggered them and are never cached.
+ * @param decl The declaration to check.
+ * @return Whether the declaration is instantiated.
+ */
+bool ScopeFilter::isInstantiated(const Decl *decl){
+    while (decl != nullptr && !isa<TranslationUnitDecl>(decl)){
+        if (auto func = dyn_cast<FunctionDecl>(decl)){
+            if (func->isTemplateInstantiation()) return true;
+        } else if (auto record = dyn_cast<CXXRecordDecl>(decl)){
+            if (isTemplateInstantiation(record->getTemplateSpecializationKind())) return true;
+        } else if (auto var = dyn_cast<VarDecl>(decl)){
+            if (isTemplateInstantiation(var->getTemplateSpecializationKind())) return true;
+        }
+
+        //Moves out to the enclosing context.
+        const DeclContext* parent = decl->getDeclContext();
+        decl = (parent == nullptr) ? nullptr : Decl::castFromDeclContext(parent);
+    }
+
+    return false;
+}
+
+/**
+ * Checks whether a file is in scope.
+ * @param fileName The name of the file.
+ * @param systemHeader Whether the file is a system header.
+ * @return Whether the file is in scope.
+ */
+bool ScopeFilter::isFileInScope(string fileName, bool systemHeader){
+    if (systemHeader && pruneSystemHeaders) return false;
+
+    //Built-in buffers have no name.
+    if (fileName.compare("") == 0) return true;
+
+    if (includeGlobs.size() > 0 && !matchesGlob(fileName, includeGlobs)) return false;
+    return !matchesGlob(fileName, excludeGlobs);
+}
+
+/**
+ * Checks whether a file matches any of the globs.
+ * @param fileName The name of the file.
+ * @param globs The globs to check.
+ * @return Whether any glob matched.
+ */
+bool ScopeFilter::matchesGlob(string fileName, vector<string> globs){
+    for (string glob : globs){
+        if (fnmatch(glob.c_str(), fileName.c_str(), 0) == 0) return true;
+    }
+
+    return false;
+}
+
+/**
+ * Creates a recorder that reports the macros each file uses to the scope filter.
+ * @param filter The scope filter to report to.
+ * @param preprocessor The preprocessor for the unit.
+ */
+HeaderMacroRecorder::HeaderMacroRecorder(ScopeFilter *filter, Preprocessor &preprocessor) :
+        filter(filter), preprocessor(preprocessor) { }
+
+/**
+ * Records the result of an #if.
+ * @param loc The location of the directive.
+ * @param conditionRange The condition.
+ * @param conditionValue The result of the condition.
+ */
+void HeaderMacroRecorder::If(SourceLocation loc, SourceRange conditionRange, ConditionValueKind conditionValue){
+    filter->recordMacroUse(preprocessor.getSourceManager(), loc, "if " + to_string(conditionValue), true);
+}
+
+/**
+ * Records the result of an #elif.
+ * @param loc The location of the directive.
+ * @param conditionRange The condition.
+ * @param conditionValue The result of the condition.
+ * @param ifLoc The location of the matching #if.
+ */
+void HeaderMacroRecorder::Elif(SourceLocation loc, SourceRange conditionRange, ConditionValueKind conditionValue,
+                               SourceLocation ifLoc){
+    filter->recordMacroUse(preprocessor.getSourceManager(), loc, "elif " + to_string(conditionValue), true);
+}
+
+/**
+ * Records the macro tested by an #ifdef.
+ * @param loc The location of the directive.
+ * @param macroNameTok The macro name.
+ * @param md The definition of the macro, if any.
+ */
+void HeaderMacroRecorder::Ifdef(SourceLocation loc, const Token &macroNameTok, const MacroDefinition &md){
+    filter->recordMacroUse(preprocessor.getSourceManager(), loc, "ifdef " + describeMacro(macroNameTok, md), true);
+}
+
+/**
+ * Records the macro tested by an #ifndef.
+ * @param loc The location of the directive.
+ * @param macroNameTok The macro name.
+ * @param md The definition of the macro, if any.
+ */
+void HeaderMacroRecorder::Ifndef(SourceLocation loc, const Token &macroNameTok, const MacroDefinition &md){
+    filter->recordMacroUse(preprocessor.getSourceManager(), loc, "ifndef " + describeMacro(macroNameTok, md), true);
+}
+
+/**
+ * Records the macro tested by defined().
+ * @param macroNameTok The macro name.
+ * @param md The definition of the macro, if any.
+ * @param range The defined() expression.
+ */
+void HeaderMacroRecorder::Defined(const Token &macroNameTok, const MacroDefinition &md, SourceRange range){
+    filter->recordMacroUse(preprocessor.getSourceManager(), range.getBegin(),
+                           "defined " + describeMacro(macroNameTok, md), true);
+}
+
+/**
+ * Records the definition of an expanded macro.
+ * @param macroNameTok The macro name.
+ * @param md The definition of the macro.
+ * @param range Where the macro was expanded.
+ * @param args The arguments of the macro.
+ */
+void HeaderMacroRecorder::MacroExpands(const Token &macroNameTok, const MacroDefinition &md, SourceRange range,
+                                       const MacroArgs *args){
+    filter->recordMacroUse(preprocessor.getSourceManager(), range.getBegin(), describeMacro(macroNameTok, md), false);
+}
+
+/**
+ * Describes a macro by its name and definition. Definitions are spelled out once each.
+ * @param macroNameTok The macro name.
+ * @param md The definition of the macro, if any.
+ * @return The description of the macro.
+ */
+string HeaderMacroRecorder::describeMacro(const Token &macroNameTok, const MacroDefinition &md){
+    string name = preprocessor.getSpelling(macroNameTok);
+    const MacroInfo* info = md.getMacroInfo();
+    if (info == nullptr) return name + " undefined";
+
+    auto cached = definitions.find(info);
+    if (cached != definitions.end()) return name + " " + cached->second;
+
+    //Spells out the parameters and the replacement tokens.
+    stringstream definition;
+    if (info->isFunctionLike()){
+        definition << "(";
+        for (auto param : info->params()) definition << param->getName().str() << ",";
+        if (info->isVariadic()) definition << "...";
+        definition << ")";
+    }
+    for (const Token &token : info->tokens()) definition << " " << preprocessor.getSpelling(token);
+
+    definitions[info] = definition.str();
+    return name + " " + definition.str();
+}
+
+/**
+ * Creates a visitor that hands in-scope nodes to the match finder.
+ * @param finder The match finder to run.
+ * @param filter The scope filter to use.
+ * @param context The AST context of the translation unit.
+ */
+ScopedMatchVisitor::ScopedMatchVisitor(MatchFinder *finder, ScopeFilter *filter, ASTContext &context) :
+        finder(finder), filter(filter), context(context) { }
+
+/**
+ * Visits template instantiations unless the traversal policy skips them.
+ * @return Whether instantiations are visited.
+ */
+bool ScopedMatchVisitor::shouldVisitTemplateInstantiations() const {
+    return filter->visitsInstantiations();
+}
+
+/**
+ * Visits implicit code unless the traversal policy skips it.
+ * @return Whether implicit code is visited.
+ */
+bool ScopedMatchVisitor::shouldVisitImplicitCode() const {
+    return filter->visitsImplicitCode();
+}
+
+/**
+ * Traverses a declaration. Out-of-scope declarations are skipped along with everything inside them.
+ * @param decl The declaration to traverse.
+ * @return Whether the traversal should continue.
+ */
+bool ScopedMatchVisitor::TraverseDecl(Decl *decl){
+    if (decl == nullptr) return true;
+    if (!filter->isInScope(context.getSourceManager(), decl)) return true;
+
+    return RecursiveASTVisitor<ScopedMatchVisitor>::TraverseDecl(decl);
+}
+
+/**
+ * Runs the matchers on a declaration.
+ * @param decl The declaration to match.
+ * @return Always true.
+ */
+bool ScopedMatchVisitor::VisitDecl(Decl *decl){
+    finder->match(*decl, context);
+    return true;
+}
+
+/**
+ * Runs the matchers on a statement.
+ * @param stmt The statement to match.
+ * @return Always true.
+ */
+bool ScopedMatchVisitor::VisitStmt(Stmt *stmt){
+    finder->match(*stmt, context);
+    return true;
+}
+
+/**
+ * Creates the consumer for a translation unit.
+ * @param finder The match finder to run.
+ * @param walkers The walkers that receive the matches.
+ * @param filter The scope filter to use.
+ */
+ExtractConsumer::ExtractConsumer(MatchFinder *finder, vector<ASTWalker*> walkers, ScopeFilter *filter) :
+        finder(finder), walkers(walkers), filter(filter) { }
+
+/**
+ * Runs the matchers over the translation unit. Walkers that run their own traversal
+ * match on the unit itself and apply the filter themselves. The other walkers only
+ * see the nodes the filter keeps.
+ * @param context The AST context of the translation unit.
+ */
+void ExtractConsumer::HandleTranslationUnit(ASTContext &context){
+    bool allSelfTraversing = true;
+    for (auto walker : walkers) allSelfTraversing = allSelfTraversing && walker->isSelfTraversing();
+
+    if (!filter->isActive()){
+        finder->matchAST(context);
+    } else {
+        //Single node matches skip the start of unit hook.
+        for (auto walker : walkers) walker->onStartOfTranslationUnit();
+        if (allSelfTraversing){
+            finder->match(*context.getTranslationUnitDecl(), context);
+        } else {
+            //The unit is in scope so self-traversing walkers are matched once on it.
+            ScopedMatchVisitor visitor(finder, filter, context);
+            visitor.TraverseDecl(context.getTranslationUnitDecl());
+        }
+        for (auto walker : walkers) walker->onEndOfTranslationUnit();
+    }
+
+    filter->endTranslationUnit(!context.getDiagnostics().hasErrorOccurred());
+}
+
+/**
+ * Creates the extraction action.
+ * @param finder The match finder to run.
+ * @param walkers The walkers that receive the matches.
+ * @param filter The scope filter to use.
+ * @param prefetcher Warms up the files after this one. Null disables prefetching.
+ */
+ExtractAction::ExtractAction(MatchFinder *finder, vector<ASTWalker*> walkers, ScopeFilter *filter,
+                             FilePrefetcher *prefetcher) :
+        finder(finder), walkers(walkers), filter(filter), prefetcher(prefetcher) { }
+
+/**
+ * Creates the consumer for the current file.
+ * @param compiler The compiler instance.
+ * @param inFile The file being processed.
+ * @return The AST consumer.
+ */
+unique_ptr<ASTConsumer> ExtractAction::CreateASTConsumer(CompilerInstance &compiler, StringRef inFile){
+    if (prefetcher != nullptr) prefetcher->advance(inFile.str());
+    filter->beginTranslationUnit(compiler.getPreprocessor());
+    return unique_ptr<ASTConsumer>(new ExtractConsumer(finder, walkers, filter));
+}
+
+/**
+ * Creates the extraction action factory.
+ * @param finder The match finder to run.
+ * @param walkers The walkers that receive the matches.
+ * @param filter The scope filter to use.
+ * @param prefetcher Warms up upcoming files. Null disables prefetching.
+ */
+ExtractActionFactory::ExtractActionFactory(MatchFinder *finder, vector<ASTWalker*> walkers, ScopeFilter *filter,
+                                           FilePrefetcher *prefetcher) :
+        finder(finder), walkers(walkers), filter(filter), prefetcher(prefetcher) { }
+
+/**
+ * Creates an extraction action for a file.
+ * @return The new frontend action.
+ */
+FrontendAction* ExtractActionFactory::create(){
+    return new ExtractAction(finder, walkers, filter, prefetcher);
+}
+
+/**
+ * Runs the matchers over a translation unit that was already built or loaded.
+ * @param unit The translation unit.
+ */
+void ExtractActionFactory::runOnUnit(ASTUnit *unit){
+    //The unit isn't preprocessed again so the macros its headers use are unknown.
+    filter->beginTranslationUnit(unit->getPreprocessor(), false);
+
+    ExtractConsumer consumer(finder, walkers, filter);
+    consumer.HandleTranslationUnit(unit->getASTContext());
+}
@@ -0,0 +1,223 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ExtractAction.h
+//
+// Frontend action that runs the AST matchers over a translation unit.
+// Uses a scope filter to skip declarations in system headers, in files
+// outside the include/exclude globs, and in headers that were already
+// extracted by an earlier translation unit.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CLANGEX_EXTRACTACTION_H
+#define CLANGEX_EXTRACTACTION_H
+
+#include <vector>
+#include <string>
+#include <set>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include "clang/AST/ASTConsumer.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/FrontendAction.h"
+#include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Preprocessor.h"
+#include "clang/Tooling/Tooling.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "ASTWalker.h"
+#include "../File/FilePrefetcher.h"
+
+class HeaderCache {
+public:
+    /** Extracted Headers */
+    bool contains(std::string key);
+    void commit(std::vector<std::string> keys);
+    int getNumHeaders();
+
+    /** Commit Log */
+    void startLog();
+    std::vector<std::string> getLog();
+
+    /** Content Hashing */
+    std::string getContentHash(const clang::SourceManager &manager, clang::FileID file);
+
+private:
+    std::mutex cacheLock;
+    std::unordered_set<std::string> extracted;
+    std::unordered_map<std::string, std::string> contentHashes;
+    bool logging = false;
+    std::vector<std::string> log;
+};
+
+class ScopeFilter {
+public:
+    /** Constructor */
+    ScopeFilter(std::vector<std::string> includeGlobs = std::vector<std::string>(),
+                std::vector<std::string> excludeGlobs = std::vector<std::string>(),
+                bool pruneSystemHeaders = true, HeaderCache* cache = nullptr,
+                ClangDriver::TraversalPolicy traversal = ClangDriver::FULL);
+
+    /** Filter Settings */
+    bool isActive();
+
+    /** Traversal Policy */
+    bool visitsInstantiations() const;
+    bool visitsImplicitCode() const;
+    bool collapsesInstantiations() const;
+    bool prunesSystemHeaders() const;
+
+    /** Translation Unit Hooks */
+    void beginTranslationUnit(clang::Preprocessor &preprocessor, bool preprocessing = true);
+    void endTranslationUnit(bool succeeded);
+
+    /** Macro Tracking */
+    void recordMacroUse(const clang::SourceManager &manager, clang::SourceLocation loc, std::string use,
+                        bool condition);
+
+    /** Scope Checks */
+    bool isInScope(const clang::SourceManager &manager, const clang::Decl *decl);
+    bool isFileInScope(std::string fileName, bool systemHeader);
+
+private:
+    enum FileScope {OUT_OF_SCOPE, IN_SCOPE, EXTRACTED};
+    typedef struct {
+        std::string conditions;
+        std::set<std::string> expansions;
+    } MacroUses;
+
+    std::vector<std::string> includeGlobs;
+    std::vector<std::string> excludeGlobs;
+    bool pruneSystemHeaders;
+    ClangDriver::TraversalPolicy traversal;
+
+    /** Header Cache */
+    HeaderCache* cache;
+    const clang::HeaderSearch* headerSearch = nullptr;
+    std::string preprocessorState;
+    std::vector<std::string> pendingHeaders;
+    bool recordingMacros = false;
+    std::unordered_map<unsigned, MacroUses> macroUses;
+
+    /** Per-File Decisions */
+    std::unordered_map<unsigned, FileScope> fileScope;
+
+    FileScope getFileScope(const clang::SourceManager &manager, clang::FileID file, clang::SourceLocation loc);
+    std::string generatePreprocessorState(clang::Preprocessor &preprocessor);
+    std::string generateMacroState(clang::FileID file);
+    bool isInstantiated(const clang::Decl *decl);
+    bool matchesGlob(std::string fileName, std::vector<std::string> globs);
+};
+
+class HeaderMacroRecorder : public clang::PPCallbacks {
+public:
+    /** Constructor */
+    HeaderMacroRecorder(ScopeFilter *filter, clang::Preprocessor &preprocessor);
+
+    /** Conditional Hooks */
+    void If(clang::SourceLocation loc, clang::SourceRange conditionRange, ConditionValueKind conditionValue) override;
+    void Elif(clang::SourceLocation loc, clang::SourceRange conditionRange, ConditionValueKind conditionValue,
+              clang::SourceLocation ifLoc) override;
+    void Ifdef(clang::SourceLocation loc, const clang::Token &macroNameTok, const clang::MacroDefinition &md) override;
+    void Ifndef(clang::SourceLocation loc, const clang::Token &macroNameTok, const clang::MacroDefinition &md) override;
+    void Defined(const clang::Token &macroNameTok, const clang::MacroDefinition &md, clang::SourceRange range) override;
+
+    /** Expansion Hooks */
+    void MacroExpands(const clang::Token &macroNameTok, const clang::MacroDefinition &md, clang::SourceRange range,
+                      const clang::MacroArgs *args) override;
+
+private:
+    ScopeFilter *filter;
+    clang::Preprocessor &preprocessor;
+    std::unordered_map<const clang::MacroInfo*, std::string> definitions;
+
+    std::string describeMacro(const clang::Token &macroNameTok, const clang::MacroDefinition &md);
+};
+
+class ScopedMatchVisitor : public clang::RecursiveASTVisitor<ScopedMatchVisitor> {
+public:
+    /** Constructor */
+    ScopedMatchVisitor(clang::ast_matchers::MatchFinder *finder, ScopeFilter *filter, clang::ASTContext &context);
+
+    /** Traversal Settings */
+    bool shouldVisitTemplateInstantiations() const;
+    bool shouldVisitImplicitCode() const;
+
+    /** Traversal Hooks */
+    bool TraverseDecl(clang::Decl *decl);
+    bool VisitDecl(clang::Decl *decl);
+    bool VisitStmt(clang::Stmt *stmt);
+
+private:
+    clang::ast_matchers::MatchFinder *finder;
+    ScopeFilter *filter;
+    clang::ASTContext &context;
+};
+
+class ExtractConsumer : public clang::ASTConsumer {
+public:
+    /** Constructor */
+    ExtractConsumer(clang::ast_matchers::MatchFinder *finder, std::vector<ASTWalker*> walkers, ScopeFilter *filter);
+
+    /** Consumer Hooks */
+    void HandleTranslationUnit(clang::ASTContext &context) override;
+
+private:
+    clang::ast_matchers::MatchFinder *finder;
+    std::vector<ASTWalker*> walkers;
+    ScopeFilter *filter;
+};
+
+class ExtractAction : public clang::ASTFrontendAction {
+public:
+    /** Constructor */
+    ExtractAction(clang::ast_matchers::MatchFinder *finder, std::vector<ASTWalker*> walkers, ScopeFilter *filter,
+                  FilePrefetcher *prefetcher = nullptr);
+
+protected:
+    /** Action Hooks */
+    std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(clang::CompilerInstance &compiler,
+                                                          llvm::StringRef inFile) override;
+
+private:
+    clang::ast_matchers::MatchFinder *finder;
+    std::vector<ASTWalker*> walkers;
+    ScopeFilter *filter;
+    FilePrefetcher *prefetcher;
+};
+
+class ExtractActionFactory : public clang::tooling::FrontendActionFactory {
+public:
+    /** Constructor */
+    ExtractActionFactory(clang::ast_matchers::MatchFinder *finder, std::vector<ASTWalker*> walkers,
+                         ScopeFilter *filter, FilePrefetcher *prefetcher = nullptr);
+
+    /** Factory Method */
+    clang::FrontendAction *create() override;
+
+    /** Prebuilt Units */
+    void runOnUnit(clang::ASTUnit *unit);
+
+private:
+    clang::ast_matchers::MatchFinder *finder;
+    std::vector<ASTWalker*> walkers;
+    ScopeFilter *filter;
+    FilePrefetcher *prefetcher;
+};
+
+
+#endif //CLANGEX_EXTRACTACTION_H
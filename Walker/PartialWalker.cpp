@@ -52,6 +52,9 @@ PartialWalker::~PartialWalker() { }
  * @param result The result that triggers this function.
  */
 void PartialWalker::run(const MatchFinder::MatchResult &result) {
+    //Tracks the enclosing functions.
+    if (updateScope(result)) return;
+
     //Look for the AST matcher being triggered.
     if (const FunctionDecl *functionDecl = result.Nodes.getNodeAs<clang::FunctionDecl>(types[FUNC_DEC])) {
         //If a function has been found.
@@ -61,7 +64,8 @@ void PartialWalker::run(const MatchFinder::MatchResult &result) {
         manageClasses(result, functionDecl, ClangNode::FUNCTION);
     } else if (const CallExpr *expr = result.Nodes.getNodeAs<clang::CallExpr>(types[FUNC_CALL])) {
         //If a function call has been found.
-        auto caller = result.Nodes.getNodeAs<clang::DeclaratorDecl>(types[CALLER]);
+        auto caller = getEnclosingFunction(result, expr->getLocStart());
+        if (caller == nullptr) return;
         if (expr->getCalleeDecl() == nullptr || expr->getCalleeDecl()->getAsFunction() == nullptr) return;
         auto callee = expr->getCalleeDecl()->getAsFunction();
 
@@ -72,28 +76,17 @@ void PartialWalker::run(const MatchFinder::MatchResult &result) {
 
         //Adds class declarations/references.
         manageClasses(result, varDecl, ClangNode::VARIABLE);
-    } else if (const VarDecl *varInside = result.Nodes.getNodeAs<clang::VarDecl>(types[VAR_INSIDE])) {
-        //Gets the parent function.
-        auto *functionDecl = result.Nodes.getNodeAs<clang::FunctionDecl>(types[INSIDE_FUNC]);
-
-        //Adds the function.
-        addVariableInsideCall(result, functionDecl, varInside);
-    } else if (const ParmVarDecl *paramInside = result.Nodes.getNodeAs<clang::ParmVarDecl>(types[PARAM_INSIDE])) {
-        //Gets the parent function.
-        auto *functionDecl = result.Nodes.getNodeAs<clang::FunctionDecl>(types[INSIDE_FUNC]);
-
-        //Adds the function.
-        addVariableInsideCall(result, functionDecl, paramInside);
     } else if (const VarDecl *varDeclExpr = result.Nodes.getNodeAs<clang::VarDecl>(types[VAR_CALL])) {
         //If a variable reference has been found.
-        auto *caller = result.Nodes.getNodeAs<clang::DeclaratorDecl>(types[CALLER_VAR]);
-        auto *expr = result.Nodes.getNodeAs<clang::Expr>(types[VAR_EXPR]);
+        auto *ref = result.Nodes.getNodeAs<clang::DeclRefExpr>(types[VAR_REF]);
+        auto *caller = getEnclosingFunction(result, ref->getLocStart());
+        if (caller == nullptr) return;
 
-        addVariableCall(result, caller, expr, varDeclExpr);
-    } else if (const FunctionDecl *functionDeclClass = result.Nodes.getNodeAs<clang::FunctionDecl>(
-            types[CLASS_DEC_FUNC])) {
-        //Get the variable declaration.
-        auto *var = result.Nodes.getNodeAs<clang::VarDecl>(types[CLASS_DEC_VAR]);
+        addVariableCall(result, caller, ref, varDeclExpr);
+    } else if (const VarDecl *var = result.Nodes.getNodeAs<clang::VarDecl>(types[CLASS_DEC_VAR])) {
+        //Get the function the variable is declared in.
+        auto *functionDeclClass = getParentFunction(var);
+        if (functionDeclClass == nullptr) return;
 
         //Add the class reference.
         manageClasses(result, functionDeclClass, ClangNode::VARIABLE, var);
@@ -122,7 +115,8 @@ void PartialWalker::run(const MatchFinder::MatchResult &result) {
         addStructDecl(result, structDecl);
     } else if (const DeclaratorDecl *itemDecl = result.Nodes.getNodeAs<clang::DeclaratorDecl>(types[STRUCT_REF_ITEM])) {
         //Get the struct being referenced.
-        auto *structDecl = result.Nodes.getNodeAs<clang::RecordDecl>(types[STRUCT_REF]);
+        auto *structDecl = getParentRecord(itemDecl);
+        if (structDecl == nullptr) return;
 
         //Adds the structure.
         addStructDecl(result, structDecl, generateFileName(result, itemDecl->getInnerLocStart()));
@@ -135,13 +129,16 @@ void PartialWalker::run(const MatchFinder::MatchResult &result) {
  * @param finder The match finder that will store these triggers.
  */
 void PartialWalker::generateASTMatches(MatchFinder *finder) {
+    //Tracks the enclosing functions.
+    if (!declsOnly && (!exclusions.cFunction || !exclusions.cVariable)) generateScopeMatches(finder);
+
     //Function methods.
     if (!exclusions.cFunction){
         //Finds function declarations for current C/C++ file.
         finder->addMatcher(functionDecl(isExpansionInMainFile()).bind(types[FUNC_DEC]), this);
 
         //Finds function calls from one function to another.
-        finder->addMatcher(callExpr(isExpansionInMainFile(), hasAncestor(functionDecl().bind(types[CALLER]))).bind(types[FUNC_CALL]), this);
+        if (!declsOnly) finder->addMatcher(callExpr(isExpansionInMainFile()).bind(types[FUNC_CALL]), this);
     }
 
     //Variable methods.
@@ -150,16 +147,16 @@ void PartialWalker::generateASTMatches(MatchFinder *finder) {
         finder->addMatcher(varDecl(isExpansionInMainFile()).bind(types[VAR_DEC]), this);
 
         //Finds variable uses from a function to a variable.
-        finder->addMatcher(declRefExpr(hasDeclaration(varDecl(isExpansionInMainFile()).bind(types[VAR_CALL])),
-                                       hasAncestor(functionDecl().bind(types[CALLER_VAR])),
-                                       hasParent(expr().bind(types[VAR_EXPR]))), this);
+        if (!declsOnly){
+            finder->addMatcher(declRefExpr(hasDeclaration(varDecl(isExpansionInMainFile()).bind(types[VAR_CALL])))
+                                       .bind(types[VAR_REF]), this);
+        }
     }
 
     //Class methods.
     if (!exclusions.cClass){
         //Finds any class declarations.
-        finder->addMatcher(varDecl(isExpansionInMainFile(), hasAncestor(functionDecl().bind(types[CLASS_DEC_FUNC])))
-                                   .bind(types[CLASS_DEC_VAR]), this);
+        finder->addMatcher(varDecl(isExpansionInMainFile()).bind(types[CLASS_DEC_VAR]), this);
     }
 
     if (!exclusions.cEnum){
@@ -176,12 +173,9 @@ void PartialWalker::generateASTMatches(MatchFinder *finder) {
         finder->addMatcher(recordDecl(isStruct(), isExpansionInMainFile()).bind(types[STRUCT_DECL]), this);
 
         //Finds items that are part of structs.
-        finder->addMatcher(varDecl(isExpansionInMainFile(),
-                                   hasAncestor(recordDecl(isStruct()).bind(types[STRUCT_REF]))).bind(types[STRUCT_REF_ITEM]), this);
-        finder->addMatcher(fieldDecl(isExpansionInMainFile(),
-                                     hasAncestor(recordDecl(isStruct()).bind(types[STRUCT_REF]))).bind(types[STRUCT_REF_ITEM]), this);
-        finder->addMatcher(functionDecl(isExpansionInMainFile(),
-                                        hasAncestor(recordDecl(isStruct()).bind(types[STRUCT_REF]))).bind(types[STRUCT_REF_ITEM]), this);
+        finder->addMatcher(varDecl(isExpansionInMainFile()).bind(types[STRUCT_REF_ITEM]), this);
+        finder->addMatcher(fieldDecl(isExpansionInMainFile()).bind(types[STRUCT_REF_ITEM]), this);
+        finder->addMatcher(functionDecl(isExpansionInMainFile()).bind(types[STRUCT_REF_ITEM]), this);
     }
 }
 
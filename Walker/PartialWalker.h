@@ -44,11 +44,10 @@ public:
 
 private:
     /** Enum and Array for AST Matcher */
-    enum {FUNC_DEC = 0, FUNC_CALL, CALLER, VAR_DEC, INSIDE_FUNC, VAR_INSIDE, PARAM_INSIDE, VAR_CALL, CALLER_VAR,
-        VAR_EXPR, CLASS_DEC_FUNC, CLASS_DEC_VAR, ENUM_DEC, ENUM_VAR, STRUCT_DECL, STRUCT_REF, STRUCT_REF_ITEM};
-    const char* types[17] = {"func_dec", "func_call", "caller", "var_dec", "inside_func", "var_inside", "param_inside",
-                             "var_call", "caller_var", "expr_var", "class_dec_func", "class_dec_var", "enum_dec",
-                             "enum_var", "struct_decl", "struct_ref", "struct_ref_item"};
+    enum {FUNC_DEC = 0, FUNC_CALL, VAR_DEC, VAR_CALL, VAR_REF, CLASS_DEC_VAR, ENUM_DEC, ENUM_VAR, STRUCT_DECL,
+        STRUCT_REF_ITEM};
+    const char* types[10] = {"func_dec", "func_call", "var_dec", "var_call", "var_ref", "class_dec_var", "enum_dec",
+                             "enum_var", "struct_decl", "struct_ref_item"};
 
     /** Manages Classes and Enums */
     void manageClasses(const MatchFinder::MatchResult result, const clang::DeclaratorDecl *decl,
@@ -0,0 +1,326 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// VisitorWalker.cpp
+//
+// Walks through the Clang AST in a blob-like formation using a single
+// recursive traversal per translation unit. Keeps the enclosing functions
+// and records on a stack instead of relying on ancestor matchers.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include "VisitorWalker.h"
+#include "ExtractAction.h"
+
+using namespace std;
+using namespace clang;
+
+/**
+ * Default Constructor.
+ * @param print The printer to use.
+ * @param lowMemory Low memory mode toggle.
+ * @param exclusions The exclusions to use.
+ * @param graph The TA Graph to use. Usually starts blank.
+ */
+VisitorWalker::VisitorWalker(Printer* print, bool lowMemory, TAGraph::ClangExclude exclusions, TAGraph* graph) :
+        BlobWalker(print, lowMemory, exclusions, graph){ }
+
+/**
+ * Default Destructor.
+ */
+VisitorWalker::~VisitorWalker(){ }
+
+/**
+ * Runs a single traversal over the matched translation unit.
+ * @param result The result that triggers this function.
+ */
+void VisitorWalker::run(const MatchFinder::MatchResult &result) {
+    auto *unit = result.Nodes.getNodeAs<clang::TranslationUnitDecl>(TU_BIND);
+    if (unit == nullptr) return;
+
+    //Resets the traversal state.
+    curResult = &result;
+    functionStack.clear();
+    recordStack.clear();
+
+    TraverseDecl(const_cast<clang::TranslationUnitDecl*>(unit));
+    curResult = nullptr;
+}
+
+/**
+ * Generates the single matcher that hands each translation unit to the visitor.
+ * @param finder The match finder that will store these triggers.
+ */
+void VisitorWalker::generateASTMatches(MatchFinder *finder){
+    finder->addMatcher(translationUnitDecl().bind(TU_BIND), this);
+}
+
+/**
+ * The visitor runs its own traversal over the translation unit.
+ * @return Always true.
+ */
+bool VisitorWalker::isSelfTraversing(){
+    return true;
+}
+
+/**
+ * Visits template instantiations unless the traversal policy skips them.
+ * @return Whether instantiations are visited.
+ */
+bool VisitorWalker::shouldVisitTemplateInstantiations() const {
+    return scopeFilter == nullptr || scopeFilter->visitsInstantiations();
+}
+
+/**
+ * Visits implicit code unless the traversal policy skips it.
+ * @return Whether implicit code is visited.
+ */
+bool VisitorWalker::shouldVisitImplicitCode() const {
+    return scopeFilter == nullptr || scopeFilter->visitsImplicitCode();
+}
+
+/**
+ * Traverses a declaration. Keeps track of the enclosing functions and records.
+ * Out-of-scope declarations are skipped along with everything inside them.
+ * @param decl The declaration to traverse.
+ * @return Whether the traversal should continue.
+ */
+bool VisitorWalker::TraverseDecl(Decl *decl){
+    if (decl == nullptr) return true;
+
+    //Skips declarations that are out of scope.
+    if (scopeFilter != nullptr && !scopeFilter->isInScope(curResult->Context->getSourceManager(), decl)) return true;
+
+    auto *funcDecl = dyn_cast<clang::FunctionDecl>(decl);
+    auto *recDecl = dyn_cast<clang::RecordDecl>(decl);
+    if (funcDecl) functionStack.push_back(funcDecl);
+    if (recDecl) recordStack.push_back(recDecl);
+
+    bool succ = RecursiveASTVisitor<VisitorWalker>::TraverseDecl(decl);
+
+    if (recDecl) recordStack.pop_back();
+    if (funcDecl) functionStack.pop_back();
+    return succ;
+}
+
+/**
+ * Visits a function declaration.
+ * @param decl The function.
+ * @return Always true.
+ */
+bool VisitorWalker::VisitFunctionDecl(FunctionDecl *decl){
+    if (!exclusions.cFunction && decl->isThisDeclarationADefinition() && !isInSystemHeader(*curResult, decl)){
+        const FunctionDecl *canonDecl = decl->getCanonicalDecl();
+
+        //Adds a function decl and its class reference.
+        addFunctionDecl(*curResult, canonDecl);
+        performAddClassCall(*curResult, canonDecl, ClangNode::FUNCTION);
+    }
+
+    if (!exclusions.cStruct) addStructItem(decl);
+    return true;
+}
+
+/**
+ * Visits a variable declaration.
+ * @param decl The variable.
+ * @return Always true.
+ */
+bool VisitorWalker::VisitVarDecl(VarDecl *decl){
+    if (!exclusions.cVariable && !isInSystemHeader(*curResult, decl) &&
+            decl->getQualifiedNameAsString().compare("") != 0){
+        //Adds a variable decl and its class reference.
+        addVariableDecl(*curResult, decl);
+        performAddClassCall(*curResult, decl, ClangNode::VARIABLE);
+
+        //Adds the scope of the variable.
+        if (!functionStack.empty()) addVariableInsideCall(*curResult, functionStack.back(), decl);
+    }
+
+    if (!exclusions.cEnum) addEnumReference(decl);
+    if (!exclusions.cStruct) addStructItem(decl);
+    addRecordReference(decl);
+    return true;
+}
+
+/**
+ * Visits a field declaration.
+ * @param decl The field.
+ * @return Always true.
+ */
+bool VisitorWalker::VisitFieldDecl(FieldDecl *decl){
+    if (!exclusions.cVariable && !isInSystemHeader(*curResult, decl) &&
+            decl->getQualifiedNameAsString().compare("") != 0){
+        //Adds a field decl and its class reference.
+        addVariableDecl(*curResult, nullptr, decl);
+        performAddClassCall(*curResult, decl, ClangNode::VARIABLE);
+
+        //Adds the scope of the field.
+        if (!functionStack.empty()) addVariableInsideCall(*curResult, functionStack.back(), nullptr, decl);
+    }
+
+    if (!exclusions.cEnum) addEnumReference(nullptr, decl);
+    if (!exclusions.cStruct) addStructItem(decl);
+    addRecordReference(nullptr, decl);
+    return true;
+}
+
+/**
+ * Visits a class, struct or union declaration.
+ * @param decl The record.
+ * @return Always true.
+ */
+bool VisitorWalker::VisitRecordDecl(RecordDecl *decl){
+    if (isInSystemHeader(*curResult, decl)) return true;
+
+    auto *classDecl = dyn_cast<clang::CXXRecordDecl>(decl);
+    if (!exclusions.cClass && classDecl && classDecl->isClass()) addClassDecl(*curResult, classDecl);
+    if (!exclusions.cStruct && decl->isStruct()) addStructDecl(*curResult, decl);
+    if (!exclusions.cUnion && decl->isUnion()) addUnionDecl(*curResult, decl);
+    return true;
+}
+
+/**
+ * Visits an enum declaration.
+ * @param decl The enum.
+ * @return Always true.
+ */
+bool VisitorWalker::VisitEnumDecl(EnumDecl *decl){
+    if (!exclusions.cEnum && !isInSystemHeader(*curResult, decl)) addEnumDecl(*curResult, decl);
+    return true;
+}
+
+/**
+ * Visits an enum constant declaration. Also links it to its enum.
+ * @param decl The enum constant.
+ * @return Always true.
+ */
+bool VisitorWalker::VisitEnumConstantDecl(EnumConstantDecl *decl){
+    if (exclusions.cEnum || isInSystemHeader(*curResult, decl)) return true;
+
+    addEnumConstantDecl(*curResult, decl);
+
+    auto *parent = dyn_cast<clang::EnumDecl>(decl->getDeclContext());
+    if (parent != nullptr) addEnumConstantCall(*curResult, parent, decl);
+    return true;
+}
+
+/**
+ * Visits a call expression. Links the enclosing function to the callee.
+ * @param expr The call.
+ * @return Always true.
+ */
+bool VisitorWalker::VisitCallExpr(CallExpr *expr){
+    if (declsOnly || exclusions.cFunction || functionStack.empty()) return true;
+    if (expr->getCalleeDecl() == nullptr || !(isa<const clang::FunctionDecl>(expr->getCalleeDecl()))) return true;
+
+    auto callee = expr->getCalleeDecl()->getAsFunction();
+    if (isInSystemHeader(*curResult, callee)) return true;
+
+    addFunctionCall(*curResult, functionStack.back(), callee);
+    return true;
+}
+
+/**
+ * Visits a reference to a declaration. Links the enclosing function to the variable.
+ * @param expr The reference.
+ * @return Always true.
+ */
+bool VisitorWalker::VisitDeclRefExpr(DeclRefExpr *expr){
+    if (declsOnly || exclusions.cVariable || functionStack.empty()) return true;
+
+    if (auto *varCallee = dyn_cast<clang::VarDecl>(expr->getDecl())){
+        if (isInSystemHeader(*curResult, varCallee)) return true;
+        addVariableCall(*curResult, functionStack.back(), expr, varCallee);
+    } else if (auto *fieldCallee = dyn_cast<clang::FieldDecl>(expr->getDecl())){
+        if (isInSystemHeader(*curResult, fieldCallee)) return true;
+        addVariableCall(*curResult, functionStack.back(), expr, nullptr, fieldCallee);
+    }
+
+    return true;
+}
+
+/**
+ * Gets the closest enclosing struct.
+ * @return The struct or null if there is none.
+ */
+const RecordDecl* VisitorWalker::getEnclosingStruct(){
+    for (auto it = recordStack.rbegin(); it != recordStack.rend(); it++){
+        if ((*it)->isStruct()) return *it;
+    }
+
+    return nullptr;
+}
+
+/**
+ * Links a declaration to the struct it is declared inside of.
+ * @param decl The declaration.
+ */
+void VisitorWalker::addStructItem(const DeclaratorDecl *decl){
+    const RecordDecl *structDecl = getEnclosingStruct();
+    if (structDecl == nullptr) return;
+
+    //Checks if the expression is in the system header.
+    if (isInSystemHeader(*curResult, decl) || isInSystemHeader(*curResult, structDecl)) return;
+
+    addRecordCall(*curResult, structDecl, decl);
+}
+
+/**
+ * Links a variable or field to the enum that is its type.
+ * @param varDecl The variable.
+ * @param fieldDecl The field.
+ */
+void VisitorWalker::addEnumReference(const VarDecl *varDecl, const FieldDecl *fieldDecl){
+    const DeclaratorDecl *decl = (varDecl) ? (const DeclaratorDecl*) varDecl : fieldDecl;
+    const Type *type = decl->getType().getTypePtrOrNull();
+    if (type == nullptr) return;
+
+    //Gets the enum being referenced.
+    if (auto *elaborated = dyn_cast<clang::ElaboratedType>(type)) type = elaborated->getNamedType().getTypePtr();
+    auto *enumType = dyn_cast<clang::EnumType>(type);
+    if (enumType == nullptr) return;
+
+    //Get whether this reference is in the system header.
+    const EnumDecl *enumDecl = enumType->getDecl();
+    if (isInSystemHeader(*curResult, decl) || isInSystemHeader(*curResult, enumDecl)) return;
+
+    addEnumCall(*curResult, enumDecl, varDecl, fieldDecl);
+}
+
+/**
+ * Links a variable or field to the struct or union that is its elaborated type.
+ * @param varDecl The variable.
+ * @param fieldDecl The field.
+ */
+void VisitorWalker::addRecordReference(const VarDecl *varDecl, const FieldDecl *fieldDecl){
+    if (exclusions.cStruct && exclusions.cUnion) return;
+
+    const DeclaratorDecl *decl = (varDecl) ? (const DeclaratorDecl*) varDecl : fieldDecl;
+    auto *elaborated = dyn_cast_or_null<clang::ElaboratedType>(decl->getType().getTypePtrOrNull());
+    if (elaborated == nullptr) return;
+
+    //Gets the record being referenced.
+    auto *recordType = dyn_cast<clang::RecordType>(elaborated->getNamedType().getTypePtr());
+    if (recordType == nullptr) return;
+
+    const RecordDecl *recordDecl = recordType->getDecl();
+    if ((recordDecl->isStruct() && exclusions.cStruct) || (recordDecl->isUnion() && exclusions.cUnion) ||
+            (!recordDecl->isStruct() && !recordDecl->isUnion())) return;
+
+    //Get whether this reference is in the system header.
+    if (isInSystemHeader(*curResult, decl) || isInSystemHeader(*curResult, recordDecl)) return;
+
+    addRecordUseCall(*curResult, recordDecl, varDecl, fieldDecl);
+}
@@ -0,0 +1,76 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+// VisitorWalker.h
+//
+// Walks through the Clang AST in a blob-like formation using a single
+// recursive traversal per translation unit. Keeps the enclosing functions
+// and records on a stack instead of relying on ancestor matchers.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CLANGEX_VISITORWALKER_H
+#define CLANGEX_VISITORWALKER_H
+
+#include <vector>
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "BlobWalker.h"
+
+class VisitorWalker : public BlobWalker, public clang::RecursiveASTVisitor<VisitorWalker> {
+public:
+    /** Constructor and Destructor */
+    explicit VisitorWalker(Printer* print, bool lowMemory,
+                           TAGraph::ClangExclude exclusions = TAGraph::ClangExclude(),
+                           TAGraph* graph = nullptr);
+    ~VisitorWalker() override;
+
+    /** Methods for running the AST Walker */
+    void run(const MatchFinder::MatchResult &result) override;
+    void generateASTMatches(MatchFinder *finder) override;
+    bool isSelfTraversing() override;
+
+    /** Traversal Settings */
+    bool shouldVisitTemplateInstantiations() const;
+    bool shouldVisitImplicitCode() const;
+
+    /** Traversal Hooks */
+    bool TraverseDecl(clang::Decl *decl);
+
+    /** Visitor Methods */
+    bool VisitFunctionDecl(clang::FunctionDecl *decl);
+    bool VisitVarDecl(clang::VarDecl *decl);
+    bool VisitFieldDecl(clang::FieldDecl *decl);
+    bool VisitRecordDecl(clang::RecordDecl *decl);
+    bool VisitEnumDecl(clang::EnumDecl *decl);
+    bool VisitEnumConstantDecl(clang::EnumConstantDecl *decl);
+    bool VisitCallExpr(clang::CallExpr *expr);
+    bool VisitDeclRefExpr(clang::DeclRefExpr *expr);
+
+private:
+    /** Matcher Binding */
+    const char* TU_BIND = "visitor_tu";
+
+    /** Traversal State */
+    const MatchFinder::MatchResult* curResult = nullptr;
+    std::vector<const clang::FunctionDecl*> functionStack;
+    std::vector<const clang::RecordDecl*> recordStack;
+
+    /** Reference Helpers */
+    const clang::RecordDecl* getEnclosingStruct();
+    void addStructItem(const clang::DeclaratorDecl *decl);
+    void addEnumReference(const clang::VarDecl *varDecl, const clang::FieldDecl *fieldDecl = nullptr);
+    void addRecordReference(const clang::VarDecl *varDecl, const clang::FieldDecl *fieldDecl = nullptr);
+};
+
+
+#endif //CLANGEX_VISITORWALKER_H